@@ -0,0 +1,32 @@
+#include <cstdlib>
+#include <new>
+
+// Replacement global operator new/delete that count heap allocations for Bench.hpp.
+// Kept in a translation unit of its own: inlined into a benchmark's cleanup code, GCC
+// pairs the free() below with the operator new call and flags a mismatch.
+
+unsigned long g_allocations = 0;
+
+void* operator new(std::size_t size) throw(std::bad_alloc)
+{
+    ++g_allocations;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) throw(std::bad_alloc)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) throw()
+{
+    free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+    free(p);
+}
@@ -0,0 +1,61 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <cstddef>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <time.h>
+
+// Minimal in-process benchmark helpers shared by the microbenchmarks.
+// Heap allocations are counted by the replacement operator new in Allocations.cpp.
+
+extern unsigned long g_allocations;
+
+inline double benchNow()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Keeps the optimizer from discarding a result
+extern volatile size_t g_sink;
+
+struct BenchResult
+{
+    std::string name;
+    unsigned long iterations;
+    double seconds;
+    unsigned long allocations;
+};
+
+inline void benchReport(const BenchResult& r)
+{
+    std::cout << std::left << std::setw(44) << r.name
+              << std::right << std::setw(10) << std::fixed << std::setprecision(1) << (r.seconds * 1e9 / r.iterations) << " ns/op"
+              << std::setw(10) << std::setprecision(2) << (double)r.allocations / r.iterations << " allocs/op\n";
+}
+
+// Runs fn(i) for the given number of iterations and reports time and allocations per call
+template <typename Fn>
+BenchResult benchRun(const std::string& name, unsigned long iterations, Fn fn)
+{
+    fn(0); // warm-up
+    unsigned long allocsBefore = g_allocations;
+    double start = benchNow();
+    for (unsigned long i = 0; i < iterations; ++i)
+        fn(i);
+    double seconds = benchNow() - start;
+    unsigned long allocations = g_allocations - allocsBefore;
+
+    BenchResult r;
+    r.name = name;
+    r.iterations = iterations;
+    r.seconds = seconds;
+    r.allocations = allocations;
+    benchReport(r);
+    return r;
+}
+
+#endif
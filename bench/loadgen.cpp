@@ -0,0 +1,440 @@
+// Load generator for ircserv.
+// Opens N connections to a running server, registers them, spreads them over M channels and
+// sends PRIVMSG at a fixed total rate from all of them in turn. Every message carries its send
+// time, so each delivery to another member gives one end-to-end latency sample. The run is
+// summarized as a single JSON line on stdout; progress and errors go to stderr.
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+enum Distribution {
+    DIST_UNIFORM, // Clients dealt round-robin: every channel has N/M members
+    DIST_ZIPF // Channel k gets a share proportional to 1/(k+1): a few large channels, a long tail of small ones
+};
+
+struct LoadConfig
+{
+    std::string host;
+    int port;
+    std::string password;
+    size_t clients;
+    size_t channels;
+    Distribution distribution;
+    unsigned long rate; // PRIVMSG per second, all clients together
+    double duration; // Seconds of traffic
+    double drainTimeout; // Seconds to wait for deliveries still in flight
+    std::string label; // Copied into the report, e.g. the commit under test
+
+    LoadConfig() : host("127.0.0.1"), port(6667), password("bench"), clients(200), channels(10), distribution(DIST_ZIPF),
+                   rate(10000), duration(10), drainTimeout(5) {}
+};
+
+struct Connection
+{
+    int fd;
+    std::string nick;
+    size_t channel;
+    std::string in; // Received bytes not yet split into lines
+    std::string out; // Queued bytes the socket did not take yet
+    bool joined;
+    bool alive;
+
+    Connection() : fd(-1), channel(0), joined(false), alive(true) {}
+};
+
+struct Totals
+{
+    unsigned long sent;
+    unsigned long expected; // Deliveries the sent messages should cause
+    unsigned long delivered;
+    unsigned long disconnects;
+    std::vector<unsigned long> latencyNs;
+
+    Totals() : sent(0), expected(0), delivered(0), disconnects(0) {}
+};
+
+static unsigned long nowNs()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000UL + now.tv_nsec;
+}
+
+static int parseOption(const std::string& arg, LoadConfig& config)
+{
+    if (arg.compare(0, 7, "--host=") == 0)
+        config.host = arg.substr(7);
+    else if (arg.compare(0, 7, "--port=") == 0) {
+        config.port = atoi(arg.c_str() + 7);
+        if (config.port <= 0 || config.port > 65535)
+            return 0;
+    }
+    else if (arg.compare(0, 11, "--password=") == 0)
+        config.password = arg.substr(11);
+    else if (arg.compare(0, 10, "--clients=") == 0) {
+        long clients = atol(arg.c_str() + 10);
+        if (clients < 2 || clients > 1000000)
+            return 0;
+        config.clients = clients;
+    }
+    else if (arg.compare(0, 11, "--channels=") == 0) {
+        long channels = atol(arg.c_str() + 11);
+        if (channels < 1 || channels > 1000000)
+            return 0;
+        config.channels = channels;
+    }
+    else if (arg == "--distribution=uniform")
+        config.distribution = DIST_UNIFORM;
+    else if (arg == "--distribution=zipf")
+        config.distribution = DIST_ZIPF;
+    else if (arg.compare(0, 7, "--rate=") == 0) {
+        long rate = atol(arg.c_str() + 7);
+        if (rate < 1 || rate > 10000000)
+            return 0;
+        config.rate = rate;
+    }
+    else if (arg.compare(0, 11, "--duration=") == 0) {
+        config.duration = atof(arg.c_str() + 11);
+        if (config.duration <= 0 || config.duration > 86400)
+            return 0;
+    }
+    else if (arg.compare(0, 8, "--drain=") == 0) {
+        config.drainTimeout = atof(arg.c_str() + 8);
+        if (config.drainTimeout < 0 || config.drainTimeout > 3600)
+            return 0;
+    }
+    else if (arg.compare(0, 8, "--label=") == 0)
+        config.label = arg.substr(8);
+    else
+        return 0;
+    return 1;
+}
+
+// Channel of each client. Sizes are deterministic, so two runs with the same options
+// put the same load on the server.
+static std::vector<size_t> assignChannels(const LoadConfig& config, std::vector<size_t>& sizes)
+{
+    size_t channels = std::min(config.channels, config.clients);
+    sizes.assign(channels, 0);
+    std::vector<size_t> assignment(config.clients);
+
+    if (config.distribution == DIST_UNIFORM) {
+        for (size_t i = 0; i < config.clients; ++i)
+            assignment[i] = i % channels;
+    } else {
+        double total = 0;
+        for (size_t k = 0; k < channels; ++k)
+            total += 1.0 / (k + 1);
+        // Every channel gets at least two members (one to speak, one to hear); the rest by weight
+        std::vector<size_t> target(channels);
+        size_t assigned = 0;
+        for (size_t k = 0; k < channels; ++k) {
+            target[k] = static_cast<size_t>(config.clients / (total * (k + 1)));
+            if (target[k] < 2)
+                target[k] = 2;
+            assigned += target[k];
+        }
+        for (size_t k = channels; assigned > config.clients && k-- > 0; ) { // Trim the tail if the minimum overshot
+            size_t cut = std::min(target[k] - 1, assigned - config.clients);
+            target[k] -= cut;
+            assigned -= cut;
+        }
+        target[0] += config.clients - assigned; // Rounding leftovers go to the largest channel
+        size_t client = 0;
+        for (size_t k = 0; k < channels; ++k)
+            for (size_t n = 0; n < target[k]; ++n)
+                assignment[client++] = k;
+    }
+
+    for (size_t i = 0; i < config.clients; ++i)
+        sizes[assignment[i]]++;
+    return assignment;
+}
+
+static void raiseFdLimit(size_t needed)
+{
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < needed) {
+        limit.rlim_cur = (limit.rlim_max < needed) ? limit.rlim_max : needed;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static int openConnection(const LoadConfig& config)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config.port);
+    if (inet_pton(AF_INET, config.host.c_str(), &addr.sin_addr) != 1)
+        return -1;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Latency, not batching, is what we measure
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+static void flushConnection(Connection& conn)
+{
+    while (conn.alive && !conn.out.empty()) {
+        ssize_t written = send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+        if (written > 0)
+            conn.out.erase(0, written);
+        else if (written < 0 && errno == EINTR)
+            continue;
+        else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        else
+            conn.alive = false;
+    }
+}
+
+// ":nick PRIVMSG #lg3 :<sendNs> <seq>": the latency sample is the time since <sendNs>
+static void handleLine(Connection& conn, const std::string& line, Totals& totals, unsigned long now)
+{
+    if (line.compare(0, 5, "PING ") == 0) {
+        conn.out += "PONG " + line.substr(5) + "\r\n";
+        return;
+    }
+    if (line.compare(0, 6, "ERROR ") == 0) {
+        std::cerr << conn.nick << ": " << line << "\n";
+        return;
+    }
+    size_t command = line.find(' ');
+    if (command == std::string::npos)
+        return;
+    if (line.compare(command, 9, " PRIVMSG ") == 0) {
+        size_t text = line.find(" :", command + 9);
+        if (text == std::string::npos)
+            return;
+        unsigned long sentAt = strtoul(line.c_str() + text + 2, NULL, 10);
+        if (sentAt != 0 && now >= sentAt) {
+            totals.delivered++;
+            totals.latencyNs.push_back(now - sentAt);
+        }
+    } else if (!conn.joined && line.compare(command, 6, " JOIN ") == 0) {
+        std::string prefix = line.substr(1, command - 1); // ":nick" or ":nick!user@host"
+        if (prefix.substr(0, prefix.find('!')) == conn.nick)
+            conn.joined = true;
+    }
+}
+
+static void readConnection(Connection& conn, Totals& totals)
+{
+    char buffer[65536];
+    while (conn.alive) {
+        ssize_t bytes = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (bytes > 0) {
+            conn.in.append(buffer, bytes);
+            continue;
+        }
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        conn.alive = false;
+    }
+
+    unsigned long now = nowNs(); // One clock read per wakeup: every line in it arrived by now
+    size_t start = 0;
+    size_t end;
+    while ((end = conn.in.find('\n', start)) != std::string::npos) {
+        size_t length = end - start;
+        if (length > 0 && conn.in[end - 1] == '\r')
+            --length;
+        handleLine(conn, conn.in.substr(start, length), totals, now);
+        start = end + 1;
+    }
+    conn.in.erase(0, start);
+}
+
+// One poll() pass over every connection, waiting at most timeoutMs
+static void pump(std::vector<Connection>& conns, std::vector<pollfd>& fds, Totals& totals, int timeoutMs)
+{
+    for (size_t i = 0; i < conns.size(); ++i) {
+        fds[i].fd = conns[i].alive ? conns[i].fd : -1;
+        fds[i].events = POLLIN | (conns[i].out.empty() ? 0 : POLLOUT);
+        fds[i].revents = 0;
+    }
+    if (poll(&fds[0], fds.size(), timeoutMs) <= 0)
+        return;
+    for (size_t i = 0; i < conns.size(); ++i) {
+        Connection& conn = conns[i];
+        if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+            readConnection(conn, totals);
+        if (!conn.out.empty())
+            flushConnection(conn);
+        if (!conn.alive && conn.fd >= 0) {
+            close(conn.fd);
+            conn.fd = -1;
+            totals.disconnects++;
+        }
+    }
+}
+
+static double percentileUs(std::vector<unsigned long>& sorted, unsigned int perMille)
+{
+    if (sorted.empty())
+        return 0;
+    size_t rank = (sorted.size() * perMille + 999) / 1000; // 1-based
+    if (rank == 0)
+        rank = 1;
+    return sorted[rank - 1] / 1000.0;
+}
+
+static std::string jsonString(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"' || text[i] == '\\')
+            quoted += '\\';
+        if (static_cast<unsigned char>(text[i]) >= 0x20)
+            quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+int main(int argc, char** argv)
+{
+    LoadConfig config;
+    for (int i = 1; i < argc; ++i) {
+        if (!parseOption(argv[i], config)) {
+            std::cerr << "Usage: ./loadgen [--host=IP] [--port=N] [--password=PASS] [--clients=N] [--channels=M]\n"
+                      << "                 [--distribution=uniform|zipf] [--rate=MSGS_PER_SEC] [--duration=SECONDS]\n"
+                      << "                 [--drain=SECONDS] [--label=TEXT]\n";
+            return 1;
+        }
+    }
+    raiseFdLimit(config.clients + 16);
+
+    std::vector<size_t> sizes;
+    std::vector<size_t> assignment = assignChannels(config, sizes);
+    std::vector<Connection> conns(config.clients);
+    std::vector<pollfd> fds(config.clients);
+    Totals totals;
+
+    // Connect and register everyone; the server is read in between so its replies never pile up
+    unsigned long connectStart = nowNs();
+    for (size_t i = 0; i < conns.size(); ++i) {
+        Connection& conn = conns[i];
+        conn.fd = openConnection(config);
+        if (conn.fd < 0) {
+            std::cerr << "loadgen: connection " << i << " failed: " << strerror(errno) << "\n";
+            return 1;
+        }
+        std::ostringstream nick;
+        nick << "lg" << i;
+        conn.nick = nick.str();
+        conn.channel = assignment[i];
+        std::ostringstream hello;
+        hello << "PASS " << config.password << "\r\nNICK " << conn.nick << "\r\nUSER " << conn.nick << " 0 * :loadgen\r\n"
+              << "AUTHENTICATE\r\nJOIN #lg" << conn.channel << "\r\n";
+        conn.out = hello.str();
+        flushConnection(conn);
+        if (i % 64 == 63)
+            pump(conns, fds, totals, 0);
+    }
+
+    size_t joined = 0;
+    unsigned long deadline = nowNs() + 30 * 1000000000UL;
+    while (joined < conns.size()) {
+        pump(conns, fds, totals, 10);
+        joined = 0;
+        for (size_t i = 0; i < conns.size(); ++i)
+            joined += conns[i].joined;
+        if (totals.disconnects > 0 || nowNs() > deadline) {
+            std::cerr << "loadgen: only " << joined << " of " << conns.size() << " clients joined their channel\n";
+            return 1;
+        }
+    }
+    double connectSeconds = (nowNs() - connectStart) / 1e9;
+    std::cerr << "loadgen: " << conns.size() << " clients in " << sizes.size() << " channels (largest " << sizes[0]
+              << ") ready after " << std::fixed << std::setprecision(2) << connectSeconds << " s\n";
+    totals.latencyNs.reserve(std::min<unsigned long>(50000000UL, static_cast<unsigned long>(config.rate * config.duration * 4)));
+
+    // Paced traffic: each pass sends whatever the clock says is due, senders taken in turn
+    unsigned long start = nowNs();
+    unsigned long end = start + static_cast<unsigned long>(config.duration * 1e9);
+    size_t speaker = 0;
+    unsigned long seq = 0;
+    while (true) {
+        unsigned long now = nowNs();
+        if (now >= end)
+            break;
+        unsigned long due = static_cast<unsigned long>((now - start) / 1e9 * config.rate);
+        while (totals.sent < due) {
+            Connection& conn = conns[speaker];
+            speaker = (speaker + 1) % conns.size();
+            if (!conn.alive)
+                continue;
+            std::ostringstream line;
+            line << "PRIVMSG #lg" << conn.channel << " :" << nowNs() << " " << seq++ << "\r\n";
+            conn.out += line.str();
+            flushConnection(conn);
+            totals.sent++;
+            totals.expected += sizes[conn.channel] - 1;
+        }
+        pump(conns, fds, totals, 1);
+    }
+    double sendSeconds = (nowNs() - start) / 1e9;
+
+    // Collect what is still in flight
+    unsigned long drainEnd = nowNs() + static_cast<unsigned long>(config.drainTimeout * 1e9);
+    while (totals.delivered < totals.expected && nowNs() < drainEnd)
+        pump(conns, fds, totals, 10);
+    double totalSeconds = (nowNs() - start) / 1e9;
+
+    for (size_t i = 0; i < conns.size(); ++i)
+        if (conns[i].fd >= 0)
+            close(conns[i].fd);
+
+    std::vector<unsigned long>& latency = totals.latencyNs;
+    std::sort(latency.begin(), latency.end());
+    std::cout << std::fixed << std::setprecision(1)
+              << "{\"label\":" << jsonString(config.label)
+              << ",\"clients\":" << config.clients
+              << ",\"channels\":" << sizes.size()
+              << ",\"distribution\":\"" << (config.distribution == DIST_ZIPF ? "zipf" : "uniform") << "\""
+              << ",\"largest_channel\":" << sizes[0]
+              << ",\"target_rate\":" << config.rate
+              << ",\"duration_s\":" << std::setprecision(2) << sendSeconds
+              << ",\"connect_s\":" << connectSeconds
+              << ",\"sent\":" << totals.sent
+              << ",\"expected_deliveries\":" << totals.expected
+              << ",\"delivered\":" << totals.delivered
+              << ",\"disconnects\":" << totals.disconnects
+              << std::setprecision(1)
+              << ",\"send_rate\":" << totals.sent / sendSeconds
+              << ",\"delivery_rate\":" << totals.delivered / totalSeconds
+              << ",\"latency_us\":{\"p50\":" << percentileUs(latency, 500)
+              << ",\"p99\":" << percentileUs(latency, 990)
+              << ",\"p999\":" << percentileUs(latency, 999)
+              << ",\"max\":" << (latency.empty() ? 0 : latency.back() / 1000.0)
+              << "}}\n";
+
+    return (totals.disconnects > 0 || totals.delivered < totals.expected) ? 2 : 0;
+}
@@ -0,0 +1,368 @@
+#include "Bench.hpp"
+#include "../includes/MessageView.hpp"
+#include "../includes/Command.hpp"
+#include "../includes/TimerWheel.hpp"
+#include "../includes/NickIndex.hpp"
+#include "../includes/Channel.hpp"
+#include "../includes/Client.hpp"
+#include "../includes/Arena.hpp"
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+volatile size_t g_sink = 0;
+
+static const char* const PRIVMSG_LINE = "PRIVMSG #general :hello everyone, this is a typical chat line";
+static const char* const MODE_LINE = ":alice!alice@127.0.0.1 MODE #general +ovl bob carol 50";
+
+// The tokenizer Command::executeCommand used before MessageView, kept as the baseline
+static size_t legacyTokenize(const std::string& commandLine)
+{
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+    while (pos < commandLine.length()) {
+        while (pos < commandLine.length() && commandLine[pos] == ' ')
+            pos++;
+        if (pos >= commandLine.length())
+            break;
+        if (commandLine[pos] == ':') {
+            std::string trailing = commandLine.substr(pos + 1);
+            if (!trailing.empty())
+                tokens.push_back(trailing);
+            break;
+        }
+        size_t found = commandLine.find(' ', pos);
+        if (found == std::string::npos) {
+            tokens.push_back(commandLine.substr(pos));
+            break;
+        }
+        tokens.push_back(commandLine.substr(pos, found - pos));
+        pos = found;
+    }
+    if (tokens.empty())
+        return 0;
+    std::string command = tokens[0];
+    std::vector<std::string> params(tokens.begin() + 1, tokens.end());
+    return command == "PRIVMSG" ? params.size() : 0;
+}
+
+struct LegacyParse
+{
+    std::string line;
+    void operator()(unsigned long) const { g_sink += legacyTokenize(line); }
+};
+
+struct ViewParse
+{
+    const char* line;
+    size_t length;
+    void operator()(unsigned long) const
+    {
+        MessageView msg;
+        msg.parse(line, length);
+        g_sink += (msg.command() == "PRIVMSG") ? msg.size() : 0;
+    }
+};
+
+// The if/else chain executeCommand used before the dispatch table; NOTICE is the last branch
+static int legacyDispatch(const StringSlice& command)
+{
+    const char* const names[] = { "PASS", "NICK", "USER", "AUTHENTICATE", "JOIN", "KICK",
+                                  "INVITE", "TOPIC", "MODE", "PRIVMSG", "NOTICE" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+        if (command == names[i])
+            return static_cast<int>(i);
+    return -1;
+}
+
+struct LegacyDispatch
+{
+    StringSlice command;
+    void operator()(unsigned long) const { g_sink += legacyDispatch(command); }
+};
+
+struct TableDispatch
+{
+    StringSlice command;
+    void operator()(unsigned long) const { g_sink += (Command::findCommand(command.data, command.len) != NULL); }
+};
+
+// Re-arms one of the wheel's timers per call, as a keepalive does when a client goes quiet
+struct TimerReschedule
+{
+    TimerWheel* wheel;
+    Timer* timers;
+    size_t count;
+    void operator()(unsigned long i) const
+    {
+        size_t k = (i * 7919) % count;
+        wheel->schedule(timers[k], 1000 + (i * 104729) % 600000);
+    }
+};
+
+struct TimerCancelArm
+{
+    TimerWheel* wheel;
+    Timer* timers;
+    size_t count;
+    void operator()(unsigned long i) const
+    {
+        size_t k = (i * 7919) % count;
+        wheel->cancel(timers[k]);
+        wheel->schedule(timers[k], 1000 + (i * 104729) % 600000);
+    }
+};
+
+struct NickValidate
+{
+    std::string nickname;
+    void operator()(unsigned long) const { g_sink += Command::isValidNickname(nickname); }
+};
+
+// What Server::getClientByNickname does: one NickIndex probe, names cycled from a fixed set
+struct NickLookup
+{
+    const NickIndex* index;
+    const std::vector<std::string>* probes;
+    void operator()(unsigned long i) const { g_sink += (index->find((*probes)[i % probes->size()]) != NULL); }
+};
+
+struct MemberLookup
+{
+    const Channel* channel;
+    Client* const* members;
+    size_t count;
+    void operator()(unsigned long i) const { g_sink += channel->hasClient(members[(i * 7919) % count]); }
+};
+
+struct OperatorLookup
+{
+    const Channel* channel;
+    Client* const* members;
+    size_t count;
+    void operator()(unsigned long i) const { g_sink += channel->isOperator(members[(i * 7919) % count]); }
+};
+
+// A member parts and joins again: swap-remove, then append
+struct PartJoin
+{
+    Channel* channel;
+    Client* const* members;
+    size_t count;
+    void operator()(unsigned long i) const
+    {
+        Client* client = members[(i * 7919) % count];
+        channel->removeClient(client);
+        channel->addClient(client);
+    }
+};
+
+// The relayed PRIVMSG line as handlers built it before Reply: std::string concatenation
+struct ConcatReply
+{
+    const MessageView* params;
+    std::string nick;
+    void operator()(unsigned long) const
+    {
+        std::string target = (*params)[0].str();
+        std::string message = params->join(1);
+        MessageBuffer line(":" + nick + " PRIVMSG " + target + " :" + message + "\r\n");
+        g_sink += line.length();
+    }
+};
+
+// The same line built in the reply arena, which the event loop resets every 256 commands here
+struct ArenaReply
+{
+    const MessageView* params;
+    std::string nick;
+    Arena* arena;
+    void operator()(unsigned long i) const
+    {
+        if (i % 256 == 0)
+            arena->reset();
+        Reply reply(*arena);
+        reply << ':' << nick << " PRIVMSG " << (*params)[0] << " :";
+        reply.appendJoined(*params, 1) << "\r\n";
+        MessageBuffer line = reply.message();
+        g_sink += line.length();
+    }
+};
+
+// A connection comes and goes: a Client-sized block from the heap, or a slab slot
+struct HeapChurn
+{
+    size_t size;
+    void operator()(unsigned long) const
+    {
+        void* block = ::operator new(size);
+        g_sink += reinterpret_cast<size_t>(block) & 1;
+        ::operator delete(block);
+    }
+};
+
+struct SlabChurn
+{
+    SlabPool* pool;
+    void operator()(unsigned long) const
+    {
+        void* block = pool->allocate();
+        g_sink += reinterpret_cast<size_t>(block) & 1;
+        pool->release(block);
+    }
+};
+
+static std::string numbered(const char* prefix, size_t n)
+{
+    std::ostringstream name;
+    name << prefix << n;
+    return name.str();
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long iterations = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+
+    std::cout << "== parser (" << iterations << " iterations)\n";
+    LegacyParse legacy;
+    legacy.line = PRIVMSG_LINE;
+    benchRun("legacy tokenize PRIVMSG (vector<string>)", iterations, legacy);
+
+    ViewParse view;
+    view.line = PRIVMSG_LINE;
+    view.length = legacy.line.length();
+    BenchResult r = benchRun("MessageView::parse PRIVMSG", iterations, view);
+
+    ViewParse prefixed;
+    prefixed.line = MODE_LINE;
+    prefixed.length = strlen(MODE_LINE);
+    BenchResult p = benchRun("MessageView::parse prefixed MODE, 4 params", iterations, prefixed);
+
+    if (r.allocations != 0 || p.allocations != 0) {
+        std::cerr << "MessageView::parse allocated " << r.allocations + p.allocations << " times\n";
+        return 1;
+    }
+
+    std::cout << "== dispatch (" << iterations << " iterations)\n";
+    Command::buildDispatchTable();
+    LegacyDispatch chain;
+    chain.command = StringSlice("NOTICE", 6);
+    benchRun("if/else chain NOTICE", iterations, chain);
+    TableDispatch table;
+    table.command = chain.command;
+    benchRun("Command::findCommand NOTICE", iterations, table);
+
+    std::cout << "== nicknames (" << iterations << " iterations)\n";
+    NickValidate valid;
+    valid.nickname = "alice_123";
+    benchRun("Command::isValidNickname valid", iterations, valid);
+    NickValidate invalid;
+    invalid.nickname = "ali.ce";
+    benchRun("Command::isValidNickname invalid", iterations, invalid);
+
+    static const size_t SIZES[] = { 10, 100, 1000, 10000, 100000 };
+    static const size_t SIZE_COUNT = sizeof(SIZES) / sizeof(SIZES[0]);
+    const size_t POPULATION = SIZES[SIZE_COUNT - 1];
+    LoopbackPeer idle; // Shared by every client: they never do I/O here
+    std::vector<Client*> clients; // Live until exit
+    for (size_t n = 0; n < POPULATION; ++n)
+        clients.push_back(new Client(new LoopbackTransport(static_cast<int>(n), &idle), "127.0.0.1"));
+
+    for (size_t s = 0; s < SIZE_COUNT; s += 2) {
+        size_t population = SIZES[s];
+        NickIndex index;
+        for (size_t n = 0; n < population; ++n)
+            index.insert(numbered("user", n), clients[n]);
+        std::vector<std::string> hits;
+        std::vector<std::string> misses;
+        for (size_t n = 0; n < 1024; ++n) {
+            hits.push_back(numbered("USER", (n * 7919) % population)); // Found through casemapping
+            misses.push_back(numbered("guest", n));
+        }
+        NickLookup lookup;
+        lookup.index = &index;
+        lookup.probes = &hits;
+        benchRun(numbered("getClientByNickname hit, nicks=", population), iterations, lookup);
+        lookup.probes = &misses;
+        benchRun(numbered("getClientByNickname miss, nicks=", population), iterations, lookup);
+    }
+
+    std::cout << "== channels (" << iterations << " iterations)\n";
+    for (size_t s = 0; s < SIZE_COUNT; ++s) {
+        size_t members = SIZES[s];
+        Channel channel("#bench");
+        for (size_t n = 0; n < members; ++n) {
+            channel.addClient(clients[n]);
+            if (n % 10 == 0)
+                channel.setOperator(clients[n]);
+        }
+        MemberLookup member;
+        member.channel = &channel;
+        member.members = &clients[0];
+        member.count = members;
+        benchRun(numbered("Channel::hasClient, members=", members), iterations, member);
+        OperatorLookup op;
+        op.channel = &channel;
+        op.members = &clients[0];
+        op.count = members;
+        benchRun(numbered("Channel::isOperator, members=", members), iterations, op);
+        PartJoin churn;
+        churn.channel = &channel;
+        churn.members = &clients[0];
+        churn.count = members;
+        benchRun(numbered("Channel part+join, members=", members), iterations, churn);
+        for (size_t n = 0; n < members; ++n)
+            channel.removeClient(clients[n]);
+    }
+
+    std::cout << "== allocation (" << iterations << " iterations)\n";
+    MessageView privmsg;
+    privmsg.parse(PRIVMSG_LINE, strlen(PRIVMSG_LINE));
+    ConcatReply concat;
+    concat.params = &privmsg;
+    concat.nick = "alice";
+    benchRun("PRIVMSG relay line, string concatenation", iterations, concat);
+    Arena arena;
+    ArenaReply arenaReply;
+    arenaReply.params = &privmsg;
+    arenaReply.nick = "alice";
+    arenaReply.arena = &arena;
+    benchRun("PRIVMSG relay line, Reply in arena", iterations, arenaReply);
+    HeapChurn heap;
+    heap.size = sizeof(Client);
+    benchRun("Client-sized operator new + delete", iterations, heap);
+    SlabPool pool("bench", sizeof(Client), 128);
+    SlabChurn slab;
+    slab.pool = &pool;
+    benchRun("Client-sized SlabPool allocate + release", iterations, slab);
+
+    static Timer timers[100000]; // Static storage, outside the counted heap
+    const size_t TIMERS = sizeof(timers) / sizeof(timers[0]);
+    std::cout << "== timers (" << TIMERS << " armed, " << iterations << " iterations)\n";
+    TimerWheel wheel(0, 100);
+    for (size_t k = 0; k < TIMERS; ++k)
+        wheel.schedule(timers[k], 1000 + (k * 104729) % 600000);
+    TimerReschedule reschedule;
+    reschedule.wheel = &wheel;
+    reschedule.timers = timers;
+    reschedule.count = TIMERS;
+    benchRun("TimerWheel::schedule (re-arm)", iterations, reschedule);
+    TimerCancelArm cancelArm;
+    cancelArm.wheel = &wheel;
+    cancelArm.timers = timers;
+    cancelArm.count = TIMERS;
+    benchRun("TimerWheel::cancel + schedule", iterations, cancelArm);
+
+    std::vector<Timer*> expired;
+    expired.reserve(TIMERS);
+    double start = benchNow();
+    wheel.advance(600000 + 1000, expired);
+    std::cout << "TimerWheel::advance over 10 minutes: " << expired.size() << " timers fired in "
+              << std::fixed << std::setprecision(2) << (benchNow() - start) * 1e3 << " ms\n";
+    if (expired.size() != TIMERS) {
+        std::cerr << "TimerWheel lost timers: " << expired.size() << " of " << TIMERS << " fired\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,571 @@
+// Trace replay for ircserv.
+// Starts a fresh server, then plays back a trace recorded with `ircserv --record=FILE`: every
+// recorded connection is opened, fed its lines and closed again at its recorded time, scaled by
+// --speed (or as fast as possible with --speed=max). A probe client messages itself a few times
+// a second throughout, which measures the delivery latency the replayed load causes. When the
+// trace is done the server is stopped and its CPU time is read back from wait4(). The run is
+// summarized as a single JSON line on stdout; progress and errors go to stderr.
+
+#include "Trace.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static const char* const PROBE_NICK = "_probe_";
+static const size_t RECORDS_PER_PASS = 64; // Records applied between two poll() passes, so replies are read as they come
+
+struct ReplayConfig
+{
+    std::string trace;
+    std::string server; // ircserv binary to start
+    int port;
+    std::string password; // Replaces the redacted password of every recorded PASS line
+    double speed; // 0 = as fast as possible
+    double probeRate; // Probe messages per second
+    double drainTimeout; // Seconds to keep reading after the last record
+    std::string label; // Copied into the report, e.g. the commit under test
+    bool dump; // Print the trace instead of replaying it
+    std::vector<std::string> serverArgs; // After "--": passed on to the server
+
+    ReplayConfig() : server("./ircserv"), port(16668), password("replay"), speed(1), probeRate(5), drainTimeout(2), dump(false) {}
+};
+
+struct Connection
+{
+    int fd;
+    std::string in; // Received bytes not yet split into lines
+    std::string out; // Queued bytes the socket did not take yet
+    bool closing; // Recorded close: the socket is closed once out is empty
+    bool syncing; // Max speed: the close waits for the answer to a PING, i.e. until the server caught up
+    bool alive;
+
+    Connection() : fd(-1), closing(false), syncing(false), alive(true) {}
+};
+
+struct Totals
+{
+    unsigned long connects;
+    unsigned long connectFailures;
+    unsigned long linesIn; // Sent to the server
+    unsigned long bytesIn;
+    unsigned long linesOut; // Received from the server
+    unsigned long bytesOut;
+    unsigned long disconnects; // Closed by the server before the trace closed them (timeouts run on the server's clock)
+    unsigned long probesSent;
+    std::vector<unsigned long> latencyNs;
+
+    Totals() : connects(0), connectFailures(0), linesIn(0), bytesIn(0), linesOut(0), bytesOut(0), disconnects(0), probesSent(0) {}
+};
+
+static unsigned long nowNs()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000UL + now.tv_nsec;
+}
+
+static int parseOption(const std::string& arg, ReplayConfig& config)
+{
+    if (arg.compare(0, 8, "--trace=") == 0)
+        config.trace = arg.substr(8);
+    else if (arg.compare(0, 9, "--server=") == 0)
+        config.server = arg.substr(9);
+    else if (arg.compare(0, 7, "--port=") == 0) {
+        config.port = atoi(arg.c_str() + 7);
+        if (config.port <= 0 || config.port > 65535)
+            return 0;
+    }
+    else if (arg.compare(0, 11, "--password=") == 0) {
+        config.password = arg.substr(11);
+        if (config.password.empty() || config.password.find_first_of(" \t") != std::string::npos)
+            return 0;
+    }
+    else if (arg == "--speed=max")
+        config.speed = 0;
+    else if (arg.compare(0, 8, "--speed=") == 0) {
+        config.speed = atof(arg.c_str() + 8);
+        if (config.speed <= 0 || config.speed > 1000000)
+            return 0;
+    }
+    else if (arg.compare(0, 13, "--probe-rate=") == 0) {
+        config.probeRate = atof(arg.c_str() + 13);
+        if (config.probeRate < 0 || config.probeRate > 100000)
+            return 0;
+    }
+    else if (arg.compare(0, 8, "--drain=") == 0) {
+        config.drainTimeout = atof(arg.c_str() + 8);
+        if (config.drainTimeout < 0 || config.drainTimeout > 3600)
+            return 0;
+    }
+    else if (arg.compare(0, 8, "--label=") == 0)
+        config.label = arg.substr(8);
+    else if (arg == "--dump")
+        config.dump = true;
+    else
+        return 0;
+    return 1;
+}
+
+static void raiseFdLimit(size_t needed)
+{
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < needed) {
+        limit.rlim_cur = (limit.rlim_max < needed) ? limit.rlim_max : needed;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static int openConnection(int port)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+// The server's stdout (its log) goes to our stderr, so that stdout holds nothing but the report
+static pid_t startServer(const ReplayConfig& config)
+{
+    std::ostringstream port;
+    port << config.port;
+    std::vector<std::string> args;
+    args.push_back(config.server);
+    args.push_back(port.str());
+    args.push_back(config.password);
+    args.push_back("--log-level=warn"); // Extra arguments come after, so they can override it
+    args.insert(args.end(), config.serverArgs.begin(), config.serverArgs.end());
+
+    std::vector<char*> argv;
+    for (size_t i = 0; i < args.size(); ++i)
+        argv.push_back(const_cast<char*>(args[i].c_str()));
+    argv.push_back(NULL);
+
+    pid_t pid = fork();
+    if (pid < 0)
+        throw std::runtime_error(std::string("fork: ") + strerror(errno));
+    if (pid == 0) {
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        execv(argv[0], &argv[0]);
+        std::cerr << "replay: cannot run " << argv[0] << ": " << strerror(errno) << "\n";
+        _exit(127);
+    }
+
+    // Ready once it accepts a connection
+    unsigned long deadline = nowNs() + 5 * 1000000000UL;
+    while (true) {
+        int fd = openConnection(config.port);
+        if (fd >= 0) {
+            close(fd);
+            return pid;
+        }
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid)
+            throw std::runtime_error("server exited during startup");
+        if (nowNs() > deadline) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            throw std::runtime_error("server did not start listening");
+        }
+        usleep(10000);
+    }
+}
+
+static void flushConnection(Connection& conn)
+{
+    while (conn.alive && !conn.out.empty()) {
+        ssize_t written = send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+        if (written > 0)
+            conn.out.erase(0, written);
+        else if (written < 0 && errno == EINTR)
+            continue;
+        else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        else
+            conn.alive = false;
+    }
+}
+
+// Replies are only counted, except PINGs: the server's keepalive runs on its own clock, not the trace's
+static void handleLine(Connection& conn, const std::string& line, Totals& totals, unsigned long now, bool probe)
+{
+    totals.linesOut++;
+    if (line.compare(0, 5, "PING ") == 0) {
+        conn.out += "PONG " + line.substr(5) + "\r\n";
+        return;
+    }
+    size_t command = line.find(' ');
+    if (command == std::string::npos)
+        return;
+    if (conn.syncing && line.compare(command, 6, " PONG ") == 0)
+        conn.syncing = false;
+    // ":_probe_ PRIVMSG _probe_ :<sendNs>"
+    if (!probe || line.compare(command, 9, " PRIVMSG ") != 0)
+        return;
+    size_t text = line.find(" :", command + 9);
+    if (text == std::string::npos)
+        return;
+    unsigned long sentAt = strtoul(line.c_str() + text + 2, NULL, 10);
+    if (sentAt != 0 && now >= sentAt)
+        totals.latencyNs.push_back(now - sentAt);
+}
+
+static void readConnection(Connection& conn, Totals& totals, bool probe)
+{
+    char buffer[65536];
+    while (conn.alive) {
+        ssize_t bytes = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (bytes > 0) {
+            totals.bytesOut += bytes;
+            conn.in.append(buffer, bytes);
+            continue;
+        }
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        conn.alive = false;
+    }
+
+    unsigned long now = nowNs();
+    size_t start = 0;
+    size_t end;
+    while ((end = conn.in.find('\n', start)) != std::string::npos) {
+        size_t length = end - start;
+        if (length > 0 && conn.in[end - 1] == '\r')
+            --length;
+        handleLine(conn, conn.in.substr(start, length), totals, now, probe);
+        start = end + 1;
+    }
+    conn.in.erase(0, start);
+}
+
+class Replayer
+{
+    private:
+        const ReplayConfig& _config;
+        std::map<unsigned long, Connection> _conns; // Recorded connection id → live connection
+        Connection _probe;
+        std::vector<pollfd> _fds;
+        std::vector<Connection*> _fdConns; // Connection owning _fds[i]
+        Totals _totals;
+
+        void closeConnection(Connection& conn)
+        {
+            close(conn.fd);
+            conn.fd = -1;
+        }
+
+    public:
+        Replayer(const ReplayConfig& config) : _config(config) {}
+
+        Totals& getTotals() { return _totals; }
+
+        bool startProbe()
+        {
+            _probe.fd = openConnection(_config.port);
+            if (_probe.fd < 0)
+                return false;
+            _probe.out = "PASS " + _config.password + "\r\nNICK " + PROBE_NICK + "\r\nUSER " + PROBE_NICK + " 0 * :replay\r\nAUTHENTICATE\r\n";
+            flushConnection(_probe);
+            return true;
+        }
+
+        void sendProbe()
+        {
+            std::ostringstream line;
+            line << "PRIVMSG " << PROBE_NICK << " :" << nowNs() << "\r\n";
+            _probe.out += line.str();
+            flushConnection(_probe);
+            _totals.probesSent++;
+        }
+
+        void apply(const TraceRecord& record)
+        {
+            if (record.type == TRACE_CONNECT) {
+                Connection& conn = _conns[record.connection];
+                conn.fd = openConnection(_config.port);
+                if (conn.fd < 0) {
+                    conn.alive = false;
+                    _totals.connectFailures++;
+                } else
+                    _totals.connects++;
+                return;
+            }
+            std::map<unsigned long, Connection>::iterator it = _conns.find(record.connection);
+            if (it == _conns.end()) // Connected before the recording started
+                return;
+            Connection& conn = it->second;
+            if (record.type == TRACE_CLOSE) {
+                conn.closing = true;
+                if (_config.speed == 0 && conn.alive) {
+                    // Closing right away would cut off replies to lines the server has not even read yet
+                    conn.out += "PING sync\r\n";
+                    conn.syncing = true;
+                    flushConnection(conn);
+                }
+            } else if (conn.alive && !conn.closing) {
+                size_t queued = conn.out.size();
+                if (record.line.compare(0, 5, "PASS ") == 0)
+                    conn.out += "PASS " + _config.password;
+                else
+                    conn.out += record.line;
+                conn.out += "\r\n";
+                _totals.linesIn++;
+                _totals.bytesIn += conn.out.size() - queued;
+                flushConnection(conn);
+            }
+            if (conn.closing && ((conn.out.empty() && !conn.syncing) || !conn.alive)) {
+                if (conn.fd >= 0)
+                    closeConnection(conn);
+                _conns.erase(it);
+            }
+        }
+
+        // One poll() pass over every connection, waiting at most timeoutMs
+        void pump(int timeoutMs)
+        {
+            _fds.clear();
+            _fdConns.clear();
+            if (_probe.fd >= 0) {
+                pollfd pfd = { _probe.fd, static_cast<short>(POLLIN | (_probe.out.empty() ? 0 : POLLOUT)), 0 };
+                _fds.push_back(pfd);
+                _fdConns.push_back(&_probe);
+            }
+            for (std::map<unsigned long, Connection>::iterator it = _conns.begin(); it != _conns.end(); ++it) {
+                if (it->second.fd < 0)
+                    continue;
+                pollfd pfd = { it->second.fd, static_cast<short>(POLLIN | (it->second.out.empty() ? 0 : POLLOUT)), 0 };
+                _fds.push_back(pfd);
+                _fdConns.push_back(&it->second);
+            }
+            if (_fds.empty()) {
+                if (timeoutMs > 0)
+                    usleep(timeoutMs * 1000);
+                return;
+            }
+            if (poll(&_fds[0], _fds.size(), timeoutMs) <= 0)
+                return;
+            for (size_t i = 0; i < _fds.size(); ++i) {
+                Connection& conn = *_fdConns[i];
+                if (_fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                    readConnection(conn, _totals, &conn == &_probe);
+                if (!conn.out.empty())
+                    flushConnection(conn);
+                if (conn.closing && conn.out.empty() && !conn.syncing)
+                    closeConnection(conn);
+                else if (!conn.alive && conn.fd >= 0) {
+                    closeConnection(conn);
+                    _totals.disconnects++;
+                }
+            }
+        }
+
+        void closeAll()
+        {
+            for (std::map<unsigned long, Connection>::iterator it = _conns.begin(); it != _conns.end(); ++it)
+                if (it->second.fd >= 0)
+                    closeConnection(it->second);
+            _conns.clear();
+            if (_probe.fd >= 0)
+                closeConnection(_probe);
+        }
+};
+
+static double percentileUs(std::vector<unsigned long>& sorted, unsigned int perMille)
+{
+    if (sorted.empty())
+        return 0;
+    size_t rank = (sorted.size() * perMille + 999) / 1000; // 1-based
+    if (rank == 0)
+        rank = 1;
+    return sorted[rank - 1] / 1000.0;
+}
+
+static std::string jsonString(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"' || text[i] == '\\')
+            quoted += '\\';
+        if (static_cast<unsigned char>(text[i]) >= 0x20)
+            quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+static bool byTime(const TraceRecord& a, const TraceRecord& b)
+{
+    return a.timeUs < b.timeUs;
+}
+
+static void dumpTrace(const std::vector<TraceRecord>& records)
+{
+    static const char* const names[] = { "", "CONNECT", "LINE", "CLOSE" };
+    for (size_t i = 0; i < records.size(); ++i) {
+        const TraceRecord& record = records[i];
+        std::cout << std::setw(12) << record.timeUs << " " << std::setw(6) << record.connection << " " << names[record.type];
+        if (record.type == TRACE_LINE)
+            std::cout << " " << record.line;
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    ReplayConfig config;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--") {
+            config.serverArgs.assign(argv + i + 1, argv + argc);
+            break;
+        }
+        if (!parseOption(argv[i], config)) {
+            config.trace.clear();
+            break;
+        }
+    }
+    if (config.trace.empty()) {
+        std::cerr << "Usage: ./replay --trace=FILE [--server=PATH] [--port=N] [--password=PASS] [--speed=N|max]\n"
+                  << "                [--probe-rate=N] [--drain=SECONDS] [--label=TEXT] [--dump] [-- SERVER_OPTIONS...]\n";
+        return 1;
+    }
+
+    std::vector<TraceRecord> records;
+    pid_t server = -1;
+    try {
+        records = readTrace(config.trace);
+        // Each reactor thread writes its own batches: order the records by time, keeping the order within a batch
+        std::stable_sort(records.begin(), records.end(), byTime);
+        if (config.dump) {
+            dumpTrace(records);
+            return 0;
+        }
+        server = startServer(config);
+    } catch (const std::exception& e) {
+        std::cerr << "replay: " << e.what() << "\n";
+        return 1;
+    }
+
+    size_t connections = 0;
+    for (size_t i = 0; i < records.size(); ++i)
+        connections += (records[i].type == TRACE_CONNECT);
+    raiseFdLimit(connections + 16);
+    unsigned long traceUs = records.empty() ? 0 : records.back().timeUs;
+    std::cerr << "replay: " << records.size() << " records, " << connections << " connections over "
+              << std::fixed << std::setprecision(2) << traceUs / 1e6 << " s of trace\n";
+
+    Replayer replayer(config);
+    if (config.probeRate > 0 && !replayer.startProbe())
+        std::cerr << "replay: probe connection failed: " << strerror(errno) << "\n";
+
+    unsigned long start = nowNs();
+    unsigned long probeIntervalNs = config.probeRate > 0 ? static_cast<unsigned long>(1e9 / config.probeRate) : 0;
+    unsigned long nextProbe = start + probeIntervalNs;
+    size_t next = 0;
+    while (next < records.size()) {
+        unsigned long now = nowNs();
+        // Records are due at their trace time divided by the speed; at max speed, all of them are due now
+        size_t last = std::min(records.size(), next + RECORDS_PER_PASS);
+        while (next < last && (config.speed == 0
+               || start + static_cast<unsigned long>(records[next].timeUs * 1000 / config.speed) <= now))
+            replayer.apply(records[next++]);
+        if (probeIntervalNs && now >= nextProbe) {
+            replayer.sendProbe();
+            nextProbe += probeIntervalNs;
+        }
+
+        int timeoutMs = 0;
+        if (next < records.size() && config.speed != 0) {
+            unsigned long due = start + static_cast<unsigned long>(records[next].timeUs * 1000 / config.speed);
+            if (probeIntervalNs && nextProbe < due)
+                due = nextProbe;
+            timeoutMs = due > now ? static_cast<int>((due - now) / 1000000) : 0;
+            if (timeoutMs > 10)
+                timeoutMs = 10;
+        }
+        replayer.pump(timeoutMs);
+    }
+    double replaySeconds = (nowNs() - start) / 1e9;
+
+    // Collect the replies still in flight; one last probe shows how long the backlog takes to clear
+    if (probeIntervalNs)
+        replayer.sendProbe();
+    unsigned long drainEnd = nowNs() + static_cast<unsigned long>(config.drainTimeout * 1e9);
+    while (nowNs() < drainEnd)
+        replayer.pump(10);
+    replayer.closeAll();
+
+    Totals& totals = replayer.getTotals();
+    kill(server, SIGINT);
+    int status = 0;
+    rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    wait4(server, &status, 0, &usage);
+    bool serverOk = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (!serverOk)
+        std::cerr << "replay: server exited abnormally (status " << status << ")\n";
+
+    std::ostringstream speed;
+    if (config.speed == 0)
+        speed << "\"max\"";
+    else
+        speed << config.speed;
+    std::vector<unsigned long>& latency = totals.latencyNs;
+    std::sort(latency.begin(), latency.end());
+    std::cout << std::fixed << std::setprecision(3)
+              << "{\"label\":" << jsonString(config.label)
+              << ",\"trace\":" << jsonString(config.trace)
+              << ",\"speed\":" << speed.str()
+              << ",\"records\":" << records.size()
+              << ",\"trace_s\":" << traceUs / 1e6
+              << ",\"replay_s\":" << replaySeconds
+              << ",\"connects\":" << totals.connects
+              << ",\"connect_failures\":" << totals.connectFailures
+              << ",\"disconnects\":" << totals.disconnects
+              << ",\"lines_in\":" << totals.linesIn
+              << ",\"bytes_in\":" << totals.bytesIn
+              << ",\"lines_out\":" << totals.linesOut
+              << ",\"bytes_out\":" << totals.bytesOut
+              << ",\"server_cpu_s\":{\"user\":" << usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+              << ",\"sys\":" << usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6
+              << "},\"probes\":{\"sent\":" << totals.probesSent
+              << ",\"received\":" << latency.size()
+              << std::setprecision(1)
+              << "},\"latency_us\":{\"p50\":" << percentileUs(latency, 500)
+              << ",\"p99\":" << percentileUs(latency, 990)
+              << ",\"max\":" << (latency.empty() ? 0 : latency.back() / 1000.0)
+              << "}}\n";
+
+    return (!serverOk || totals.connectFailures > 0) ? 2 : 0;
+}
@@ -0,0 +1,363 @@
+// Socket-free simulation of ircserv.
+// Runs the real server — reactor, parser, command handlers, channels, fan-out, flushing —
+// on the loopback backend, with every client an in-memory LoopbackPeer in this process. No
+// kernel networking is involved, so the numbers are the cost of the server logic alone, and
+// a run is deterministic: the same options give the same command sequence and, with
+// --checksum, the same output hash on every build that behaves the same.
+//
+// Phases: connect and register every client into a channel, send PRIVMSG from random
+// members, then disconnect and reconnect a share of the clients. The run is summarized as
+// a single JSON line on stdout. With --idle, only the first phase runs, and the report is
+// the memory the server grew by to hold that many idle registered clients.
+
+#include "Bench.hpp"
+#include "../includes/Server.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include <fstream>
+#include <unistd.h> // for sysconf()
+
+struct SimulationConfig
+{
+    size_t clients;
+    size_t channels;
+    unsigned long messages; // PRIVMSG sent in the traffic phase
+    size_t batch; // Clients that are ready in one event loop iteration
+    double churn; // Share of the clients that reconnect in the last phase
+    unsigned long seed;
+    bool checksum; // Hash every byte the server writes (slower)
+    bool idle; // Connect and register only, then report resident memory
+    std::string label;
+
+    SimulationConfig() : clients(50000), channels(500), messages(1000000), batch(256), churn(0.1), seed(1), checksum(false), idle(false) {}
+};
+
+// Same sequence on every platform, unlike rand()
+struct Random
+{
+    unsigned long state;
+
+    Random(unsigned long seed) : state(seed * 2862933555777941757UL + 3037000493UL) {}
+    size_t below(size_t n)
+    {
+        state = state * 6364136223846793005UL + 1442695040888963407UL;
+        return (state >> 33) % n;
+    }
+};
+
+static int parseOption(const std::string& arg, SimulationConfig& config)
+{
+    if (arg.compare(0, 10, "--clients=") == 0) {
+        long clients = atol(arg.c_str() + 10);
+        if (clients < 2 || clients > 100000000)
+            return 0;
+        config.clients = clients;
+    }
+    else if (arg.compare(0, 11, "--channels=") == 0) {
+        long channels = atol(arg.c_str() + 11);
+        if (channels < 1 || channels > 10000000)
+            return 0;
+        config.channels = channels;
+    }
+    else if (arg.compare(0, 11, "--messages=") == 0)
+        config.messages = strtoul(arg.c_str() + 11, NULL, 10);
+    else if (arg.compare(0, 8, "--batch=") == 0) {
+        long batch = atol(arg.c_str() + 8);
+        if (batch < 1 || batch > 1000000)
+            return 0;
+        config.batch = batch;
+    }
+    else if (arg.compare(0, 8, "--churn=") == 0) {
+        config.churn = atof(arg.c_str() + 8);
+        if (config.churn < 0 || config.churn > 1)
+            return 0;
+    }
+    else if (arg.compare(0, 7, "--seed=") == 0)
+        config.seed = strtoul(arg.c_str() + 7, NULL, 10);
+    else if (arg == "--checksum")
+        config.checksum = true;
+    else if (arg == "--idle")
+        config.idle = true;
+    else if (arg.compare(0, 8, "--label=") == 0)
+        config.label = arg.substr(8);
+    else
+        return 0;
+    return 1;
+}
+
+class Simulation
+{
+    private:
+        const SimulationConfig& _config;
+        Server* _server;
+        std::vector<LoopbackPeer*> _peers;
+        std::vector<Client*> _clients; // Server side of _peers[i]
+        std::vector<size_t> _channelOf;
+        std::vector<Client*> _ready;
+        unsigned long _connections; // Ever made, names the next nickname
+        unsigned long _retiredBytes; // Received by peers that were disconnected
+        unsigned long _retiredHash;
+
+        void retire(size_t i)
+        {
+            _retiredBytes += _peers[i]->getBytesReceived();
+            _retiredHash = _retiredHash * 31 + _peers[i]->getOutputHash();
+            delete _peers[i];
+        }
+
+    public:
+        Simulation(const SimulationConfig& config, const ServerConfig& serverConfig)
+            : _config(config), _server(new Server(0, "sim", serverConfig)), _peers(config.clients), _clients(config.clients),
+              _channelOf(config.clients), _connections(0), _retiredBytes(0), _retiredHash(0) {}
+
+        ~Simulation()
+        {
+            delete _server; // First: closing its connections still reaches the peers
+            for (size_t i = 0; i < _peers.size(); ++i)
+                delete _peers[i];
+        }
+
+        void connect(size_t i, size_t channel) // queues the registration of client i; it runs when i is next ready
+        {
+            prepare(i, channel);
+            attach(i);
+        }
+
+        void prepare(size_t i, size_t channel) // creates client i's end, with its registration lines, without connecting it
+        {
+            _peers[i] = new LoopbackPeer(_config.checksum ? LoopbackPeer::HASH_OUTPUT : LoopbackPeer::DISCARD_OUTPUT);
+            _channelOf[i] = channel;
+            std::ostringstream hello;
+            hello << "PASS sim\r\nNICK s" << _connections << "\r\nUSER s" << _connections << " 0 * :sim\r\nAUTHENTICATE\r\nJOIN #sim" << channel << "\r\n";
+            _peers[i]->send(hello.str());
+            ++_connections;
+        }
+
+        void attach(size_t i)
+        {
+            _clients[i] = _server->connectLoopback(_peers[i]);
+        }
+
+        void disconnect(size_t i) // the server reads the end of the stream and tells the channels
+        {
+            _peers[i]->hangUp();
+        }
+
+        // Marks client i ready, and runs an iteration once a batch is full (or when flushing)
+        void ready(size_t i)
+        {
+            _ready.push_back(_clients[i]);
+            if (_ready.size() >= _config.batch)
+                run();
+        }
+
+        void run()
+        {
+            _server->runLoopback(_ready);
+            _ready.clear();
+        }
+
+        void retireClosed(std::vector<size_t>& gone) // frees the peers whose connection the server has released
+        {
+            for (size_t k = 0; k < gone.size(); ++k) {
+                if (!_peers[gone[k]]->isClosed())
+                    throw std::runtime_error("server kept a connection its peer hung up");
+                retire(gone[k]);
+                _peers[gone[k]] = NULL;
+            }
+        }
+
+        void speak(size_t i, unsigned long seq)
+        {
+            std::ostringstream line;
+            line << "PRIVMSG #sim" << _channelOf[i] << " :message " << seq << " from a simulated client\r\n";
+            _peers[i]->send(line.str());
+        }
+
+        unsigned long bytesOut() const
+        {
+            unsigned long total = _retiredBytes;
+            for (size_t i = 0; i < _peers.size(); ++i)
+                total += _peers[i]->getBytesReceived();
+            return total;
+        }
+
+        unsigned long outputHash() const
+        {
+            unsigned long hash = _retiredHash;
+            for (size_t i = 0; i < _peers.size(); ++i)
+                hash = hash * 31 + _peers[i]->getOutputHash();
+            return hash;
+        }
+
+        bool allOpen() const
+        {
+            for (size_t i = 0; i < _peers.size(); ++i)
+                if (_peers[i]->isClosed())
+                    return false;
+            return true;
+        }
+};
+
+static unsigned long residentBytes() // from /proc/self/statm, 0 where there is none
+{
+    std::ifstream statm("/proc/self/statm");
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    if (!(statm >> size >> resident))
+        return 0;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+static std::string jsonString(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"' || text[i] == '\\')
+            quoted += '\\';
+        if (static_cast<unsigned char>(text[i]) >= 0x20)
+            quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+// --idle: how much the server grows to hold config.clients registered clients that stay quiet
+static void measureIdle(const SimulationConfig& config, const ServerConfig& serverConfig)
+{
+    Simulation sim(config, serverConfig);
+    Random random(config.seed);
+
+    // The peers and their registration lines are in the baseline: the growth is the server's
+    for (size_t i = 0; i < config.clients; ++i)
+        sim.prepare(i, random.below(config.channels));
+    unsigned long before = residentBytes();
+    double start = benchNow();
+    for (size_t i = 0; i < config.clients; ++i) {
+        sim.attach(i);
+        sim.ready(i);
+    }
+    sim.run();
+    double connectSeconds = benchNow() - start;
+    unsigned long grown = residentBytes() - before;
+    if (!sim.allOpen())
+        throw std::runtime_error("server closed a connection nobody hung up");
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "{\"label\":" << jsonString(config.label)
+              << ",\"clients\":" << config.clients
+              << ",\"channels\":" << config.channels
+              << ",\"seed\":" << config.seed
+              << ",\"connect_s\":" << connectSeconds
+              << ",\"idle_rss_bytes\":" << grown
+              << std::setprecision(0)
+              << ",\"bytes_per_client\":" << static_cast<double>(grown) / config.clients
+              << std::setprecision(1)
+              << ",\"mib_per_100k_clients\":" << static_cast<double>(grown) / config.clients * 100000 / (1024 * 1024)
+              << "}\n";
+}
+
+int main(int argc, char** argv)
+{
+    SimulationConfig config;
+    for (int i = 1; i < argc; ++i) {
+        if (!parseOption(argv[i], config)) {
+            std::cerr << "Usage: ./simulate [--clients=N] [--channels=M] [--messages=N] [--batch=N] [--churn=SHARE]\n"
+                      << "                  [--seed=N] [--checksum] [--idle] [--label=TEXT]\n";
+            return 1;
+        }
+    }
+
+    ServerConfig serverConfig;
+    serverConfig.backend = BACKEND_LOOPBACK;
+    serverConfig.flood.rate = 0;
+    serverConfig.sendQ = 0; // Peers take everything: nothing is ever queued
+    serverConfig.pingInterval = 0; // No wall-clock deadlines, so runs are repeatable
+    serverConfig.registrationTimeout = 0;
+    serverConfig.log.level = LOG_WARN;
+
+    try {
+        Log::start(serverConfig.log);
+        if (config.idle) {
+            measureIdle(config, serverConfig);
+            Log::stop();
+            return 0;
+        }
+        Simulation sim(config, serverConfig);
+        Random random(config.seed);
+
+        // Phase 1: everyone registers and joins a channel
+        double start = benchNow();
+        for (size_t i = 0; i < config.clients; ++i) {
+            sim.connect(i, random.below(config.channels));
+            sim.ready(i);
+        }
+        sim.run();
+        double connectSeconds = benchNow() - start;
+        unsigned long connectBytes = sim.bytesOut();
+
+        // Phase 2: PRIVMSG from random clients, a batch of speakers per iteration
+        unsigned long allocationsBefore = g_allocations;
+        start = benchNow();
+        for (unsigned long seq = 0; seq < config.messages; ++seq) {
+            size_t speaker = random.below(config.clients);
+            sim.speak(speaker, seq);
+            sim.ready(speaker);
+        }
+        sim.run();
+        double trafficSeconds = benchNow() - start;
+        unsigned long trafficAllocations = g_allocations - allocationsBefore;
+        unsigned long trafficBytes = sim.bytesOut() - connectBytes;
+
+        // Phase 3: a reconnect wave, each leaving client is replaced by a new one in a random channel
+        size_t leaving = static_cast<size_t>(config.clients * config.churn);
+        std::vector<size_t> gone;
+        for (size_t k = 0; k < leaving; ++k)
+            gone.push_back((k * 7919) % config.clients);
+        std::sort(gone.begin(), gone.end());
+        gone.erase(std::unique(gone.begin(), gone.end()), gone.end());
+        start = benchNow();
+        for (size_t k = 0; k < gone.size(); ++k) {
+            sim.disconnect(gone[k]);
+            sim.ready(gone[k]);
+        }
+        sim.run();
+        sim.retireClosed(gone);
+        for (size_t k = 0; k < gone.size(); ++k) {
+            sim.connect(gone[k], random.below(config.channels));
+            sim.ready(gone[k]);
+        }
+        sim.run();
+        double churnSeconds = benchNow() - start;
+        if (!sim.allOpen())
+            throw std::runtime_error("server closed a connection nobody hung up");
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << "{\"label\":" << jsonString(config.label)
+                  << ",\"clients\":" << config.clients
+                  << ",\"channels\":" << config.channels
+                  << ",\"seed\":" << config.seed
+                  << ",\"connect_s\":" << connectSeconds
+                  << ",\"messages\":" << config.messages
+                  << ",\"traffic_s\":" << trafficSeconds
+                  << std::setprecision(1)
+                  << ",\"ns_per_message\":" << (config.messages ? trafficSeconds * 1e9 / config.messages : 0)
+                  << ",\"allocs_per_message\":" << std::setprecision(2) << (config.messages ? static_cast<double>(trafficAllocations) / config.messages : 0)
+                  << ",\"traffic_bytes_out\":" << trafficBytes
+                  << ",\"reconnects\":" << gone.size()
+                  << std::setprecision(3)
+                  << ",\"churn_s\":" << churnSeconds
+                  << ",\"bytes_out\":" << sim.bytesOut();
+        if (config.checksum)
+            std::cout << ",\"output_hash\":\"" << std::hex << sim.outputHash() << std::dec << "\"";
+        std::cout << "}\n";
+    } catch (const std::exception& e) {
+        Log::stop();
+        std::cerr << "simulate: " << e.what() << "\n";
+        return 1;
+    }
+    Log::stop();
+    return 0;
+}
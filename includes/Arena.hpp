@@ -0,0 +1,93 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <string>
+#include <cstddef>
+#include "MessageBuffer.hpp"
+#include "MessageView.hpp"
+
+// Allocation accounting of one Arena
+struct ArenaStats
+{
+    size_t chunkSize;
+    unsigned long chunks; // Held right now
+    unsigned long bytesReserved; // Held right now
+    unsigned long allocations;
+    unsigned long resets;
+    unsigned long peakBytes; // Most bytes handed out between two resets
+    unsigned long overflowChunks; // Chunks added because one iteration outgrew the first
+
+    ArenaStats();
+};
+
+// Bump allocator for short-lived bytes. Blocks are never freed one by one: reset() drops
+// everything at once and keeps the first chunk for the next round, so scratch data built
+// and thrown away within an event loop iteration costs a pointer bump, not a malloc/free.
+// Not locked: an arena belongs to one thread.
+class Arena
+{
+    private:
+        struct Chunk {
+            Chunk* next; // Older chunk
+            size_t size; // Usable bytes after the header
+        };
+
+        size_t _chunkSize;
+        Chunk* _chunks; // Newest first; reset() keeps the oldest
+        char* _top;
+        char* _end;
+        char* _last; // Most recent block, the only one grow() can extend in place
+        size_t _used; // Bytes handed out since the last reset
+        ArenaStats _stats;
+
+        void addChunk(size_t minimum);
+
+        Arena(const Arena&);
+        Arena& operator=(const Arena&);
+
+    public:
+        static const size_t CHUNK_SIZE = 64 * 1024;
+
+        explicit Arena(size_t chunkSize = CHUNK_SIZE);
+        ~Arena();
+
+        char* allocate(size_t size);
+        char* grow(char* block, size_t size, size_t newSize); // Moves the block unless it is the most recent one
+        void reset();
+        ArenaStats getStats() const;
+};
+
+// Reply line assembled in an arena. Building a reply with std::string concatenation costs an
+// allocation per intermediate; this appends into arena memory and copies once, into the
+// MessageBuffer that is queued. The bytes are gone at the arena's next reset.
+class Reply
+{
+    private:
+        Arena& _arena;
+        char* _data;
+        size_t _length;
+        size_t _capacity;
+
+        void reserve(size_t length);
+
+        Reply(const Reply&);
+        Reply& operator=(const Reply&);
+
+    public:
+        static const size_t INITIAL_CAPACITY = 512; // One IRC line
+
+        explicit Reply(Arena& arena);
+
+        Reply& append(const char* data, size_t length);
+        Reply& appendJoined(const MessageView& params, size_t from); // Like MessageView::join()
+        Reply& operator<<(const char* text);
+        Reply& operator<<(const std::string& text);
+        Reply& operator<<(const StringSlice& text);
+        Reply& operator<<(char c);
+
+        const char* data() const;
+        size_t length() const;
+        MessageBuffer message() const;
+};
+
+#endif
@@ -6,49 +6,100 @@
 #include <set>
 #include <memory>
 #include "Client.hpp"
+#include "Pool.hpp"
+
+enum MemberFlags {
+    MEMBER_OP = 1 << 0
+};
+
+enum ChannelMode {
+    CMODE_INVITE_ONLY = 1 << 0, // +i
+    CMODE_TOPIC_LOCK = 1 << 1, // +t
+    CMODE_KEY = 1 << 2, // +k <key>
+    CMODE_LIMIT = 1 << 3 // +l <count>
+};
+
+// How MODE applies one mode letter
+struct ModeDescriptor {
+    enum Kind { CHANNEL_FLAG, CHANNEL_KEY, CHANNEL_LIMIT, MEMBER_STATUS };
+
+    char letter;
+    Kind kind;
+    unsigned int bit; // ChannelMode, or MemberFlags for MEMBER_STATUS
+    bool paramOnSet; // Consumes an argument with '+'
+    bool paramOnUnset; // Consumes an argument with '-'
+    const char* missingParam; // ERR_NEEDMOREPARAMS text when the argument is absent
+};
+
+// One row of a channel's member table
+struct ChannelMember {
+    Client* client;
+    unsigned int flags; // MemberFlags
+};
 
 class Channel {
     private:
     std::string _name;
     std::string _topic;
-    std::set<Client*> _clients;
-    std::set<Client*> _operators;
+    // Dense member table, walked sequentially for fan-out. Each member's row is found through
+    // the slot recorded in its Client, and removal swaps the last row into the hole.
+    std::vector<ChannelMember> _members;
+    size_t _operatorCount;
     std::set<Client*> _invited;
-    std::set<char> _modes;
-    std::string _key;
-    size_t _userLimit;
-        
+    unsigned int _modes; // ChannelMode bits
+    std::string _key; // Set iff CMODE_KEY
+    size_t _userLimit; // Non-zero iff CMODE_LIMIT
+    std::string _modeString; // RPL_CHANNELMODEIS text, rebuilt when a mode changes
+    mutable std::vector<std::string> _namesChunks; // RPL_NAMREPLY name lists, each fits one 512-byte line
+    mutable bool _namesValid; // Cleared on parts, op changes and member renames; joins append
+
+    static const ModeDescriptor _modeTable[];
+    static SlabPool _pool; // Every Channel lives in a slab slot, reused as channels empty and are recreated
+
+    ChannelMember* findMember(Client* client);
+    const ChannelMember* findMember(Client* client) const;
+    void updateModeString();
+    size_t namesBudget() const;
+    void appendName(const ChannelMember& member) const;
+
     public:
+        static const size_t NAME_MAX_LENGTH = 200; // RFC 1459; JOIN refuses longer names
+
         Channel(const std::string& name);
         ~Channel();
 
+        static void* operator new(size_t size);
+        static void operator delete(void* channel, size_t size);
+        static PoolStats getPoolStats();
+
         const std::string& getName() const;
         const std::string& getTopic() const;
         void setTopic(const std::string& topic);
 
         void addClient(Client* client);
-        void removeClient(const std::string& nickname);
-        bool hasClient(const std::string& nickname) const;
+        void removeClient(Client* client);
+        bool hasClient(Client* client) const;
 
-        void setOperator(const std::string& nickname);
-        const std::string& getOperator() const;
+        void setOperator(Client* client);
         bool isOperator(Client* client) const;
-
         void removeOperator(Client* client);
+        bool hasOperators() const;
 
         bool isInviteOnly() const;
         void addInvitation(Client* client);
         void removeInvitation(Client* client);
         bool isInvited(Client* client) const;
 
-        const std::set<Client*>& getClients() const;
+        const std::vector<ChannelMember>& getMembers() const;
+        size_t getMemberCount() const;
+        const std::vector<std::string>& getNamesChunks() const;
+        void invalidateNames();
 
 
-        void addMode(char mode);
-        void removeMode(char mode);
-        bool hasMode(char mode) const;
-        std::string getModes() const;
-        bool isOperator(const std::string& nickname) const;
+        static const ModeDescriptor* findMode(char letter);
+        void setMode(ChannelMode mode, bool enabled);
+        bool hasMode(ChannelMode mode) const;
+        const std::string& getModeString() const;
         void setKey(const std::string& key);
         const std::string& getKey() const;
         void removeKey();
@@ -2,47 +2,191 @@
 #define CLIENT_HPP
 
 #include <string>
+#include <vector>
+#include "MessageBuffer.hpp"
+#include "MessageView.hpp"
+#include "InputBuffer.hpp"
+#include "TimerWheel.hpp"
+#include "Transport.hpp"
+#include "Pool.hpp"
+#include "SymbolTable.hpp"
+
+class Reactor;
+class Channel;
+
+// A channel the client has joined and the client's row in its member table
+struct ChannelLink
+{
+    Channel* channel;
+    size_t slot;
+};
+
+// Outbound write accounting, accumulated by Client::flushOutput()
+struct FlushStats
+{
+    unsigned long writeCalls; // writev() syscalls issued
+    unsigned long messagesWritten; // queued messages completely written
+    unsigned long bytesWritten;
+    unsigned long sendQEvictions; // clients disconnected for exceeding their send queue limit
+
+    FlushStats();
+    unsigned long syscallsSaved() const; // compared to one send() per message
+};
+
+// Per-client command rate: up to `burst` lines at once, refilled at `rate` lines per second
+struct FloodPolicy
+{
+    unsigned int burst;
+    unsigned int rate; // 0 disables flood control
+
+    FloodPolicy();
+    bool enabled() const;
+};
+
+// Flood control accounting, kept by each reactor
+struct FloodStats
+{
+    unsigned long throttledLines; // lines that had to wait for the client's budget
+    unsigned long maxDelayMs; // longest a throttled client waited before its lines ran
+
+    FloodStats();
+};
+
+// A client's remaining line budget, in thousandths of a line so slow rates refill exactly
+struct TokenBucket
+{
+    unsigned long tokens;
+    unsigned long lastRefill; // monotonic milliseconds
+    bool started; // The first refill fills the bucket
+
+    TokenBucket();
+    void refill(unsigned long now, const FloodPolicy& policy);
+    bool hasToken() const;
+    void take();
+    unsigned long msUntilToken(const FloodPolicy& policy) const;
+};
 
 class Client
 {
     private:
-        int _socketFd; // Client socket file descriptor
+        Transport* _transport; // Socket or in-memory connection (owned)
         std::string _ipAddr;
-        std::string _nickname;
-        std::string _username;
-        std::string _realname;
-        std::string _buffer; // Buffer to store incoming data
+        const Symbol* _nickname; // Interned in the server's NickIndex, NULL before NICK
+        char* _userInfo; // "username\0realname\0" in one block of exactly that size, NULL before USER
+        InputBuffer _input; // Buffer to store incoming data
         bool _hasSentPass;
         bool _hasSentNick;
         bool _hasSentUser;
         bool _isRegistered;
         bool _isAuthenticated;
+        std::vector<MessageBuffer> _outQueue; // Replies waiting for the socket to become writable (shared with other recipients)
+        size_t _outHead; // First unwritten entry of _outQueue; the ones before it are spent
+        size_t _outOffset; // Bytes of _outQueue[_outHead] already written by a previous partial send
+        size_t _outBytes; // Unwritten bytes in _outQueue, checked against the SendQ limit
+        bool _flushScheduled; // Already listed for the end-of-iteration flush
+        bool _writeArmed; // Waiting for POLLOUT/EPOLLOUT because the socket was full
+        Reactor* _reactor; // Event loop that owns this client's socket
+        bool _closing; // Disconnected, waiting for the core thread to release it
+        std::vector<ChannelLink> _channels; // Joined channels and member table slots, kept in sync by Channel. A client is in few channels: scanned, no tree
+        std::vector<Channel*> _invitations; // Channels holding an invitation for this client, kept in sync by Channel
+        TokenBucket _bucket; // Flood control budget
+        bool _throttled; // Waiting in its reactor's round-robin queue for more budget
+        unsigned long _throttledSince; // When it started waiting (monotonic ms)
+        bool _readBlocked; // Input buffer full of waiting lines: socket reads paused
+        bool _backlogged; // Socket full with replies pending: socket reads paused until it drains
+        bool _evicting; // Exceeded its SendQ, disconnected at the end of the loop iteration
+        std::string _quitReason; // Sent to its channels in the QUIT notice, empty for the default
+        Timer _keepaliveTimer; // Next PING, or the deadline for its PONG
+        Timer _registrationTimer; // Disconnects the client if it has not authenticated by then
+        unsigned long _lastActivity; // monotonic milliseconds of the last data received
+        unsigned long _pingSentAt; // 0 when no PING is outstanding
+        unsigned long _connectionId; // Unique for the life of the server, unlike the fd
+
+        static SlabPool _pool; // Every Client lives in a slab slot, reused as connections come and go
+
+        void makeOutputRoom();
+
+        Client(const Client&);
+        Client& operator=(const Client&);
 
     public:
-        Client(int socketFd, const std::string& ipAddr);
+        Client(Transport* transport, const std::string& ipAddr);
         ~Client();
 
+        static void* operator new(size_t size);
+        static void operator delete(void* client, size_t size);
+        static PoolStats getPoolStats();
+
         int getSocketFd() const;
+        Transport& getTransport();
+        const std::string& getIpAddr() const;
         const std::string& getNickname() const;
-        const std::string& getUsername() const;
-        const std::string& getRealname() const;
+        const std::string& getPrefix() const; // ":nick", cached with the nick
+        const Symbol* getNicknameSymbol() const;
+        const char* getUsername() const;
+        const char* getRealname() const;
         bool isReg() const;
         bool isAuth() const;
         bool hasSentPass() const;
         bool hasSentNick() const;
         bool hasSentUser() const;
 
-        void setRealname(const std::string& realname);
-        void setNickname(const std::string& nickname);
-        void setUsername(const std::string& username);
+        void setNickname(const Symbol* nickname);
+        void setUserInfo(const StringSlice& username, const StringSlice& realname);
         void HasSentPass(bool status);
         void HasSentNick(bool status);
         void HasSentUser(bool status);
         void setAuth(bool status);
         void setReg(bool status);
-        std::string& getBuffer();
-        void appendToBuffer(const std::string& data);
-        void clearBuffer();
+        InputBuffer& getInput();
+
+        void queueMessage(const MessageBuffer& message);
+        bool hasPendingOutput() const;
+        size_t getQueuedBytes() const;
+        void abortOutput(const std::string& farewell);
+        bool flushOutput(FlushStats& stats);
+        void releaseIdleOutput(); // Frees the queue's storage if nothing is waiting in it
+        bool isFlushScheduled() const;
+        void setFlushScheduled(bool status);
+        bool isWriteArmed() const;
+        void setWriteArmed(bool status);
+        Reactor* getReactor() const;
+        void setReactor(Reactor* reactor);
+        bool isClosing() const;
+        void setClosing(bool status);
+
+        static const size_t NOT_MEMBER = static_cast<size_t>(-1);
+
+        void setChannelSlot(Channel* channel, size_t slot);
+        void leftChannel(Channel* channel);
+        size_t getChannelSlot(Channel* channel) const; // NOT_MEMBER if not joined
+        bool isInChannel(Channel* channel) const;
+        const std::vector<ChannelLink>& getChannels() const;
+        void invitedTo(Channel* channel);
+        void invitationDropped(Channel* channel);
+        const std::vector<Channel*>& getInvitations() const;
+
+        TokenBucket& getBucket();
+        bool isThrottled() const;
+        void setThrottled(bool status, unsigned long since = 0);
+        unsigned long getThrottledSince() const;
+        bool isReadBlocked() const;
+        void setReadBlocked(bool status);
+        bool isBacklogged() const;
+        void setBacklogged(bool status);
+        bool isEvicting() const;
+        void setEvicting(bool status);
+        const std::string& getQuitReason() const;
+        void setQuitReason(const std::string& reason);
+
+        Timer& getKeepaliveTimer();
+        Timer& getRegistrationTimer();
+        unsigned long getLastActivity() const;
+        void setLastActivity(unsigned long now);
+        unsigned long getPingSentAt() const;
+        void setPingSentAt(unsigned long now);
+        unsigned long getConnectionId() const;
+        void setConnectionId(unsigned long id);
 };
 
 #endif
\ No newline at end of file
@@ -3,28 +3,63 @@
 
 #include <string>
 #include <vector>
+#include <cstring>
+#include <stdexcept>
 #include "Client.hpp"
 #include "Server.hpp"
-#include <sys/socket.h> //for send() : it is used for sending messages to clients 
+#include "MessageView.hpp"
+
+typedef void (*CommandHandler)(const MessageView& params, Client& client, Server& server);
+
+enum CommandFlags {
+    CMD_NEEDS_AUTH = 1 << 0, // Rejected with 451 until the client has authenticated
+    CMD_SILENT = 1 << 1 // Failed checks are dropped without a reply (NOTICE)
+};
+
+// Dispatch table entry: requirements checked once in executeCommand() before the handler runs
+struct CommandSpec {
+    const char* name;
+    CommandHandler handler;
+    size_t minParams;
+    size_t maxParams;
+    int flags;
+};
 
 class Command {
     private:
-        static void AUTHENTICATE(Client& client, Server& server);
-        static void PASS(const std::vector<std::string>& params, Client& client, Server& server);
-        static void NICK(const std::vector<std::string>& params, Client& client, Server& server);
-        static bool isValidNickname(const std::string& nickname);
-        static void USER(const std::vector<std::string>& params, Client& client, Server& server);
+        static const size_t SLOT_COUNT = 64; // Power of two, at least twice the number of commands
+        static const CommandSpec _commands[];
+        static const CommandSpec* _slots[SLOT_COUNT];
+        static bool _tableBuilt;
+
+        static unsigned int hashName(const char* name, size_t length);
 
-        static void JOIN(const std::vector<std::string>& params, Client& client, Server& server);
-        static void KICK(const std::vector<std::string>& params, Client& client, Server& server);
-        static void INVITE(const std::vector<std::string>& params, Client& client, Server& server);
-        static void TOPIC(const std::vector<std::string>& params, Client& client, Server& server);
-        static void MODE(const std::vector<std::string>& params, Client& client, Server& server);
-        static void PRIVMSG(const std::vector<std::string>& params, Client& client, Server& server);
-        static void NOTICE(const std::vector<std::string>& params, Client& client, Server& server);
+        static void AUTHENTICATE(const MessageView& params, Client& client, Server& server);
+        static void PASS(const MessageView& params, Client& client, Server& server);
+        static void NICK(const MessageView& params, Client& client, Server& server);
+        static void USER(const MessageView& params, Client& client, Server& server);
+
+        static void JOIN(const MessageView& params, Client& client, Server& server);
+        static void KICK(const MessageView& params, Client& client, Server& server);
+        static void INVITE(const MessageView& params, Client& client, Server& server);
+        static void TOPIC(const MessageView& params, Client& client, Server& server);
+        static void MODE(const MessageView& params, Client& client, Server& server);
+        static void PRIVMSG(const MessageView& params, Client& client, Server& server);
+        static void NOTICE(const MessageView& params, Client& client, Server& server);
+        static void NAMES(const MessageView& params, Client& client, Server& server);
+        static void sendNames(const Channel* channel, const std::string& channelName, Client& client, Server& server);
+        static void PING(const MessageView& params, Client& client, Server& server);
+        static void PONG(const MessageView& params, Client& client, Server& server);
+        static void STATS(const MessageView& params, Client& client, Server& server);
 
     public:
-        static void executeCommand(const std::string& commandLine, Client& client, Server& server);
+        static void buildDispatchTable();
+        static const CommandSpec* findCommand(const char* name, size_t length);
+        static bool isValidNickname(const std::string& nickname);
+        static void executeCommand(const char* line, size_t length, Client& client, Server& server);
+        // executeCommand() in two steps, so threaded mode can parse on the reactors and run on the core thread
+        static bool parseCommand(const char* line, size_t length, MessageView& message, const CommandSpec*& spec); // false when the line holds no command
+        static void runCommand(const MessageView& params, const CommandSpec* spec, size_t length, Client& client, Server& server);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef INPUTBUFFER_HPP
+#define INPUTBUFFER_HPP
+
+#include <cstddef>
+
+// Fixed-capacity receive buffer for one connection.
+// recv() writes straight into the free tail, complete lines are handed out as
+// pointers into the buffer (no copy, no per-line erase), and the leftover partial
+// line is moved to the front only when the tail runs short. A line longer than the
+// RFC 1459 limit is reported once and discarded up to its newline, so a client that
+// never sends '\n' cannot grow the buffer.
+// An empty buffer holds no memory: a read lands in storage lent by the reactor, and
+// settle() copies whatever is left after dispatch (a partial line, lines waiting for
+// flood budget) into storage of its own, which it frees again once drained. Idle and
+// line-at-a-time clients therefore own nothing.
+class InputBuffer
+{
+    public:
+        static const size_t CAPACITY = 4096;
+        static const size_t MAX_LINE = 512; // RFC 1459: including the trailing CR-LF
+
+        enum LineStatus {
+            LINE_NONE, // No complete line buffered
+            LINE_OK, // line/length point at a complete line, CR-LF stripped
+            LINE_TOO_LONG // An overlong line was dropped
+        };
+
+        InputBuffer();
+        ~InputBuffer();
+
+        void lend(char* scratch); // CAPACITY bytes the next read may use if this buffer holds nothing
+        void settle(); // After dispatch: gives lent storage back, and frees its own once empty
+
+        char* writePtr();
+        size_t writable();
+        void commit(size_t bytes);
+
+        LineStatus nextLine(const char*& line, size_t& length);
+        void compact();
+        bool empty() const;
+
+    private:
+        char* _data; // NULL, lent, or owned
+        bool _lent; // _data belongs to the reactor
+        size_t _head; // Start of the first unconsumed byte
+        size_t _tail; // End of the received bytes
+        size_t _scan; // Bytes before this offset are known not to contain '\n'
+        bool _discarding; // Inside an overlong line, skipping until its newline
+
+        InputBuffer(const InputBuffer&);
+        InputBuffer& operator=(const InputBuffer&);
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include <string>
+#include <cstddef>
+#include <pthread.h>
+
+enum LogLevel {
+    LOG_ERROR,
+    LOG_WARN,
+    LOG_INFO,
+    LOG_DEBUG,
+    LOG_TRACE // One record per command line
+};
+
+enum LogCategory {
+    LOG_SERVER,
+    LOG_CONNECTION,
+    LOG_COMMAND,
+    LOG_CHANNEL,
+    LOG_CATEGORIES
+};
+
+struct LogConfig
+{
+    LogLevel level; // Records above this level are skipped before they are formatted
+    unsigned int sample[LOG_CATEGORIES]; // Keep one INFO-or-lower record in N per category (errors and warnings always pass)
+    size_t ringRecords; // Capacity of the ring, rounded up to a power of two
+
+    LogConfig();
+};
+
+// Fixed-size slot of the ring. The sequence number says whose turn it is: the producer that
+// claimed position p publishes p + 1, the writer hands the slot back as p + capacity.
+struct LogRecord
+{
+    static const size_t TEXT = 232; // Longer messages are truncated
+
+    volatile unsigned long sequence;
+    unsigned long timeMs; // Wall clock, taken by the producer
+    unsigned char level;
+    unsigned char category;
+    unsigned short length;
+    char text[TEXT];
+};
+
+// Asynchronous logger. Any thread formats a record on its stack and copies it into a bounded
+// multi-producer ring with one compare-and-swap; a background thread turns records into lines
+// and writes them to stdout in batches. Producers never block or allocate: when the ring is
+// full the record is dropped and counted, and a slow stdout only stalls the writer thread.
+class Log
+{
+    private:
+        static LogConfig _config;
+        static LogRecord* _ring;
+        static unsigned long _mask;
+        static volatile unsigned long _head; // Next position to claim
+        static volatile unsigned long _sampleCounters[LOG_CATEGORIES];
+        static volatile unsigned long _written;
+        static volatile unsigned long _dropped; // Ring full
+        static volatile unsigned long _sampledOut;
+        static volatile int _stopping;
+        static bool _running;
+        static pthread_t _writer;
+
+        Log();
+
+        static void* writerMain(void* arg);
+        static size_t drain(unsigned long& tail, char* out, size_t capacity);
+        static size_t format(const LogRecord& record, char* out);
+        static void writeAll(const char* data, size_t length);
+
+    public:
+        static void start(const LogConfig& config);
+        static void stop(); // Writes out what is left, then a summary line
+
+        static bool shouldLog(LogLevel level, LogCategory category); // Applies the level and the sampling
+        static void write(LogLevel level, LogCategory category, const char* text, size_t length);
+
+        static bool parseLevel(const std::string& name, LogLevel& level); // "error" ... "trace"
+        static bool parseCategory(const std::string& name, LogCategory& category); // "server", "conn", "command", "channel"
+
+        static unsigned long getWritten();
+        static unsigned long getDropped();
+        static unsigned long getSampledOut();
+};
+
+// One log line, built in place on the stack and submitted when it goes out of scope:
+//     if (Log::shouldLog(LOG_INFO, LOG_CONNECTION))
+//         LogLine(LOG_INFO, LOG_CONNECTION) << "New client connected: " << fd;
+class LogLine
+{
+    private:
+        LogLevel _level;
+        LogCategory _category;
+        size_t _length;
+        char _text[LogRecord::TEXT];
+
+        LogLine(const LogLine&);
+        LogLine& operator=(const LogLine&);
+
+        LogLine& appendUnsigned(unsigned long value, bool negative);
+
+    public:
+        LogLine(LogLevel level, LogCategory category);
+        ~LogLine();
+
+        LogLine& append(const char* data, size_t length);
+        LogLine& operator<<(const char* text);
+        LogLine& operator<<(const std::string& text);
+        LogLine& operator<<(char c);
+        LogLine& operator<<(int value);
+        LogLine& operator<<(unsigned int value);
+        LogLine& operator<<(long value);
+        LogLine& operator<<(unsigned long value);
+};
+
+#endif
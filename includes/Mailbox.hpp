@@ -0,0 +1,86 @@
+#ifndef MAILBOX_HPP
+#define MAILBOX_HPP
+
+#include <vector>
+#include <stdexcept>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+// Batched message passing between threads.
+// Producers hand over a whole batch per loop iteration (one lock, one swap) and the
+// consumer is woken through a pipe it watches alongside its sockets. The pipe is only
+// written when the mailbox goes from empty to non-empty, so a busy consumer is not
+// flooded with wakeups.
+template <typename T>
+class Mailbox
+{
+    private:
+        pthread_mutex_t _mutex;
+        std::vector<T> _items;
+        int _pipe[2]; // [0] watched by the consumer, [1] written by producers
+
+        Mailbox(const Mailbox&);
+        Mailbox& operator=(const Mailbox&);
+
+    public:
+        Mailbox()
+        {
+            if (pipe(_pipe) < 0)
+                throw std::runtime_error("Failed to create mailbox pipe");
+            fcntl(_pipe[0], F_SETFL, O_NONBLOCK);
+            fcntl(_pipe[1], F_SETFL, O_NONBLOCK);
+            pthread_mutex_init(&_mutex, NULL);
+        }
+
+        ~Mailbox()
+        {
+            pthread_mutex_destroy(&_mutex);
+            close(_pipe[0]);
+            close(_pipe[1]);
+        }
+
+        int getWakeFd() const
+        {
+            return _pipe[0];
+        }
+
+        // Moves the batch into the mailbox (leaving it empty) and wakes the consumer if needed
+        void post(std::vector<T>& batch)
+        {
+            if (batch.empty())
+                return;
+            pthread_mutex_lock(&_mutex);
+            bool wasEmpty = _items.empty();
+            if (wasEmpty)
+                _items.swap(batch);
+            else
+                _items.insert(_items.end(), batch.begin(), batch.end());
+            pthread_mutex_unlock(&_mutex);
+            batch.clear();
+            if (wasEmpty)
+                wake();
+        }
+
+        // Consumer side: clears the wakeup first so a post racing with take() still wakes us again
+        void take(std::vector<T>& out)
+        {
+            char drain[64];
+            while (read(_pipe[0], drain, sizeof(drain)) > 0)
+                ;
+            out.clear();
+            pthread_mutex_lock(&_mutex);
+            out.swap(_items);
+            pthread_mutex_unlock(&_mutex);
+        }
+
+        // Async-signal-safe: used by the SIGINT handler to interrupt a blocked loop
+        void wake()
+        {
+            char byte = 1;
+            ssize_t ret = write(_pipe[1], &byte, 1);
+            (void)ret; // A full pipe already means a wakeup is pending
+        }
+};
+
+#endif
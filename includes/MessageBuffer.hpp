@@ -0,0 +1,49 @@
+#ifndef MESSAGEBUFFER_HPP
+#define MESSAGEBUFFER_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "Pool.hpp"
+
+// Immutable, reference-counted serialized message.
+// A broadcast serializes its line once; every recipient's outbound queue then
+// holds a handle to the same bytes, and the payload is freed when the last
+// recipient has flushed (and dropped) its handle. The count is atomic because
+// recipients on different reactor threads drop their handles concurrently.
+// Count, length and bytes share one block, taken from a size-class SlabPool when
+// the line fits one (every line a client can send does) and from the heap otherwise.
+class MessageBuffer
+{
+    private:
+        struct Payload {
+            size_t refCount;
+            size_t length;
+            SlabPool* pool; // NULL when the block came from the heap
+            char data[1]; // Really `length` bytes and a NUL
+        };
+        Payload* _payload;
+
+        static SlabPool* poolFor(size_t blockSize);
+        void assign(const char* data, size_t length);
+        void release();
+
+    public:
+        MessageBuffer();
+        explicit MessageBuffer(const std::string& data);
+        MessageBuffer(const char* data, size_t length);
+        MessageBuffer(const MessageBuffer& other);
+        MessageBuffer& operator=(const MessageBuffer& other);
+        ~MessageBuffer();
+
+        void swap(MessageBuffer& other); // Trades handles, the counts are untouched
+        const char* data() const;
+        size_t length() const;
+        bool empty() const;
+        size_t useCount() const;
+
+        static std::vector<PoolStats> getPoolStats();
+        static unsigned long getHeapPayloads(); // Blocks too large for the biggest size class
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef MESSAGEVIEW_HPP
+#define MESSAGEVIEW_HPP
+
+#include <string>
+#include <cstddef>
+
+// Non-owning piece of a received line
+struct StringSlice
+{
+    const char* data;
+    size_t len;
+
+    StringSlice();
+    StringSlice(const char* data, size_t len);
+
+    size_t length() const;
+    bool empty() const;
+    char operator[](size_t i) const;
+    bool operator==(const char* literal) const;
+    bool operator==(const std::string& other) const;
+    bool operator!=(const char* literal) const;
+    std::string str() const;
+};
+
+// One parsed IRC message: [':' prefix ' '] command {' ' param} [' :' trailing]
+// Every field points into the caller's line buffer, so parsing never allocates;
+// the line must outlive the view.
+class MessageView
+{
+    public:
+        static const size_t MAX_PARAMS = 15; // RFC 1459
+
+    private:
+        StringSlice _prefix;
+        StringSlice _command;
+        StringSlice _params[MAX_PARAMS];
+        size_t _paramCount;
+
+    public:
+        MessageView();
+
+        bool parse(const char* line, size_t length);
+
+        const StringSlice& prefix() const;
+        const StringSlice& command() const;
+        size_t size() const;
+        const StringSlice& operator[](size_t i) const;
+        std::string join(size_t from) const;
+};
+
+#endif
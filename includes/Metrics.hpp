@@ -0,0 +1,60 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <cstddef>
+
+unsigned long monotonicNs();
+
+// Log-bucketed histogram: bucket 0 counts zeros, bucket i counts values in [2^(i-1), 2^i).
+// Recording is a bit scan and two adds, so it can sit on the hot path.
+struct Histogram
+{
+    static const size_t BUCKETS = 32; // Values from 2^30 up share the last bucket
+
+    unsigned long buckets[BUCKETS];
+    unsigned long count;
+    unsigned long sum;
+    unsigned long max;
+
+    Histogram();
+    void record(unsigned long value);
+    void merge(const Histogram& other);
+    unsigned long percentile(unsigned int perMille) const; // Upper bound of the bucket holding it
+};
+
+// Event loop metrics, written only by the reactor that owns them
+struct LoopMetrics
+{
+    unsigned long bytesIn;
+    unsigned long bytesOut;
+    Histogram iterationNs; // Time from wakeup to the end of the iteration's flush
+    Histogram readyFds; // Events reported per wakeup
+
+    LoopMetrics();
+    void merge(const LoopMetrics& other);
+};
+
+struct CommandMetrics
+{
+    static const unsigned long TIMING_SAMPLE = 16; // Handler time is recorded for one call in 16, starting with the first
+
+    unsigned long calls;
+    unsigned long bytes; // Command line bytes, as in RPL_STATSCOMMANDS
+    Histogram handlerNs;
+
+    CommandMetrics();
+};
+
+// Command metrics, written only by the thread that executes commands
+struct CoreMetrics
+{
+    static const size_t MAX_COMMANDS = 32; // Indexed like Command's dispatch table
+
+    CommandMetrics commands[MAX_COMMANDS];
+    unsigned long unknownCommands;
+    Histogram fanout; // Recipients per broadcast
+
+    CoreMetrics();
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef NICKINDEX_HPP
+#define NICKINDEX_HPP
+
+#include <string>
+#include <vector>
+#include "SymbolTable.hpp"
+
+class Client;
+
+// Nickname → Client index, the single authority for nick lookup, registration and renames.
+// Each nick is interned once: the Client holds its Symbol, so a rename edits that one entry
+// and every reader sees the new name and prefix. Case-insensitive (RFC 1459), see SymbolTable.
+class NickIndex
+{
+    private:
+        SymbolTable _symbols;
+        std::vector<Client*> _clients; // By symbol id
+
+        NickIndex(const NickIndex&);
+        NickIndex& operator=(const NickIndex&);
+
+    public:
+        NickIndex();
+
+        Client* find(const std::string& nickname) const;
+        const Symbol* insert(const std::string& nickname, Client* client); // NULL if the nick is taken
+        bool erase(const std::string& nickname);
+        bool rename(const Symbol* nickname, const std::string& newNickname); // false if the new nick is taken
+        size_t size() const;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <cstddef>
+#include <vector>
+#include <pthread.h>
+
+// Allocation accounting of one SlabPool
+struct PoolStats
+{
+    const char* name;
+    size_t objectSize; // Slot size, rounded up to the alignment
+    unsigned long slabs;
+    unsigned long capacity; // Slots in all slabs
+    unsigned long inUse;
+    unsigned long peakInUse;
+    unsigned long allocations;
+    unsigned long frees;
+
+    PoolStats();
+};
+
+// Fixed-size object allocator. Slots are carved out of large slabs and recycled through an
+// intrusive free list, so objects that come and go with connections never reach malloc once
+// the pool has grown to the peak population, and cannot fragment the heap around them.
+// Slabs are kept until the pool is destroyed. Locked, because objects may be freed on
+// another thread than the one that allocated them.
+class SlabPool
+{
+    private:
+        struct FreeSlot {
+            FreeSlot* next;
+        };
+
+        const char* _name;
+        size_t _objectSize;
+        size_t _objectsPerSlab;
+        FreeSlot* _free;
+        std::vector<char*> _slabs;
+        PoolStats _stats;
+        mutable pthread_mutex_t _mutex;
+
+        void grow();
+
+        SlabPool(const SlabPool&);
+        SlabPool& operator=(const SlabPool&);
+
+    public:
+        static const size_t ALIGNMENT = 16;
+
+        SlabPool(const char* name, size_t objectSize, size_t objectsPerSlab);
+        ~SlabPool();
+
+        void* allocate(); // Throws std::bad_alloc
+        void release(void* object);
+        size_t getObjectSize() const;
+        PoolStats getStats() const;
+};
+
+#endif
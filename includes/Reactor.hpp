@@ -0,0 +1,159 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <poll.h> // for poll()
+#include <pthread.h>
+#ifdef __linux__
+# include <sys/epoll.h> // for epoll_create(), epoll_ctl(), epoll_wait()
+#endif
+#include "Client.hpp"
+#include "MessageBuffer.hpp"
+#include "Mailbox.hpp"
+#include "TimerWheel.hpp"
+#include "Metrics.hpp"
+#include "Trace.hpp"
+#include "MessageView.hpp"
+
+enum EventBackend {
+    BACKEND_POLL, // poll() over every connection on each wakeup
+    BACKEND_EPOLL, // edge-triggered epoll, cost per wakeup depends on ready fds only
+    BACKEND_LOOPBACK // no sockets: in-memory clients, the caller drives each iteration with runLoopback()
+};
+
+class Server;
+struct ServerConfig;
+struct CommandSpec;
+
+// Work handed from a reactor thread to the core thread that executes commands
+struct CoreEvent
+{
+    enum Type { CONNECT, LINE, DISCONNECT };
+
+    Type type;
+    Client* client;
+    MessageBuffer line; // LINE: the bytes, in a pooled block
+    MessageView message; // LINE: parsed by the reactor, every slice points into `line`
+    const CommandSpec* spec; // LINE: NULL for an unknown command
+
+    CoreEvent(Type type, Client* client);
+};
+
+// Work handed from the core thread back to the reactor that owns a client
+struct ReactorMessage
+{
+    enum Type { DELIVER, REGISTERED, RELEASE };
+
+    Type type;
+    Client* client;
+    MessageBuffer message;
+
+    ReactorMessage(Type type, Client* client, const MessageBuffer& message = MessageBuffer());
+};
+
+// One event loop: a listening socket, the connections it accepted, and their socket I/O.
+// With a single reactor, commands run inline on the loop. With several, each reactor
+// runs on its own thread with its own SO_REUSEPORT listener, forwards complete lines to
+// the core thread and gets replies back through its mailbox.
+class Reactor
+{
+    private:
+        Server& _server;
+        int _id;
+        int _port;
+        EventBackend _backend;
+        bool _threaded; // Commands run on the core thread, not inline
+        int _listenFd;
+        int _epollFd; // epoll instance (BACKEND_EPOLL only)
+        pthread_t _thread;
+        bool _started;
+        std::vector<pollfd> _pollFds; // Poll file descriptors: mailbox wake pipe, listening socket, then every client socket
+        std::vector<Client*> _pollClients; // Client owning _pollFds[i] (NULL for the pipe and the listening socket)
+        std::vector<Client*> _clients; // Indexed by socket FD, NULL where it is not one of this reactor's clients (owned)
+        std::vector<int> _freeLoopbackIds; // BACKEND_LOOPBACK: stand-in fds of released clients, reused like the kernel reuses fds
+        int _nextLoopbackId;
+        char _readScratch[InputBuffer::CAPACITY]; // Receives for clients whose input buffer holds nothing
+        std::vector<Client*> _pendingFlush; // Clients that got replies during this loop iteration
+        std::vector<CoreEvent> _coreEvents; // Parsed commands and disconnects for the core thread, posted once per iteration
+        std::vector<ReactorMessage> _inboxBatch; // Scratch space reused by processInbox()
+        Mailbox<ReactorMessage> _inbox; // Deliveries and releases from the core thread
+        FlushStats _flushStats;
+        FloodPolicy _flood;
+        std::deque<Client*> _throttled; // Clients with lines waiting for budget, served round-robin
+        unsigned long _throttleWaitMs; // Until the next waiting client earns a token
+        FloodStats _floodStats;
+        size_t _sendQLimit; // 0 = unlimited
+        std::vector<Client*> _evictions; // Over their SendQ this iteration, disconnected by evictClients()
+        enum TimerKind { TIMER_KEEPALIVE, TIMER_REGISTRATION };
+        TimerWheel _timers; // Keepalive and registration deadlines of every client
+        std::vector<Timer*> _expired; // Scratch space reused by expireTimers()
+        unsigned long _now; // monotonic milliseconds, sampled once per loop wakeup
+        unsigned long _clockSkewMs; // BACKEND_LOOPBACK: how far advanceClock() moved _now ahead of the monotonic clock
+        unsigned long _pingIntervalMs; // 0 = no keepalive
+        unsigned long _pingTimeoutMs;
+        unsigned long _registrationTimeoutMs; // 0 = no limit
+        unsigned long _wakeNs; // When the current iteration started
+        TraceWriter* _trace; // Server's trace file, NULL unless recording
+        std::string _traceBatch; // Records of this iteration, written out by endIteration()
+        LoopMetrics _loopMetrics;
+        LoopMetrics _publishedMetrics; // Threaded mode: copy for STATS on the core thread, under _metricsMutex
+        mutable pthread_mutex_t _metricsMutex;
+
+        void setupListener();
+        void setupEpoll();
+        void watch(int fd, Client* client);
+        void unwatch(Client* client);
+        void runPoll();
+        void runEpoll();
+        void beginIteration(int ready);
+        void endIteration();
+        void acceptNewConnections();
+        void adopt(Client* client);
+        bool handleClientData(Client* client);
+        bool handleHangUp(Client* client);
+        size_t dispatchLines(Client* client);
+        void serviceThrottled();
+        void evictClients();
+        void expireTimers();
+        void keepalive(Client* client);
+        void dropClient(Client* client, const std::string& reason);
+        unsigned long traceTime() const;
+        int loopTimeout() const;
+        bool flushClient(Client* client);
+        void flushPendingClients();
+        void setWriteInterest(Client* client, bool enable);
+        void processInbox();
+        void closeClient(Client* client);
+        void releaseClient(Client* client);
+
+        static void* threadMain(void* arg);
+
+    public:
+        Reactor(Server& server, int id, int port, const ServerConfig& config);
+        ~Reactor();
+
+        int getId() const;
+
+        void run();
+        void start();
+        void join();
+        void wake();
+        void post(std::vector<ReactorMessage>& batch);
+
+        // BACKEND_LOOPBACK: the caller plays the event loop
+        int reserveLoopbackId(); // a stand-in fd for the next attach()
+        Client* attach(Transport* transport, const std::string& ip); // as if just accepted
+        void runLoopback(const std::vector<Client*>& ready); // one iteration in which these clients are readable and writable
+        void advanceClock(unsigned long ms); // deadlines see this much more time pass, without waiting for it
+
+        void queueMessage(Client& client, const MessageBuffer& message);
+        void clientRegistered(Client* client);
+        const FlushStats& getFlushStats() const;
+        const FloodStats& getFloodStats() const;
+        LoopMetrics getLoopMetrics() const;
+};
+
+#endif
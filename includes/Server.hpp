@@ -4,20 +4,40 @@
 #include <string>
 #include <vector>
 #include <map>
-#include <poll.h> // for poll()
+#include <csignal> // for sig_atomic_t
 #include <cstring> // for memset
 #include <unistd.h> // for close()
-#include <fcntl.h> // File control definitions
-#include <netinet/in.h> // Internet address family
-#include <sys/socket.h> // Socket definitions
-#include <arpa/inet.h> // Internet operations definitions
 #include "Client.hpp"
 #include "Channel.hpp"
+#include "MessageBuffer.hpp"
+#include "Mailbox.hpp"
+#include "Reactor.hpp"
+#include "NickIndex.hpp"
+#include "Metrics.hpp"
+#include "Arena.hpp"
+#include "Log.hpp"
 
 enum NicknameOperation {
     CHECK,
     REGISTER,
-    UNREGISTER
+    UNREGISTER,
+    RENAME // Respells the client's interned nick in place, or registers its first one
+};
+
+// Startup options, filled from the command line in main.cpp
+struct ServerConfig
+{
+    EventBackend backend; // Event notification mechanism
+    int threads; // Reactor threads, each with its own SO_REUSEPORT listener (1 = everything on the main thread)
+    FloodPolicy flood; // Per-client command rate limit
+    size_t sendQ; // Bytes a client may have queued before it is disconnected (0 = unlimited)
+    unsigned int pingInterval; // Seconds of silence before the server PINGs a client (0 = no keepalive)
+    unsigned int pingTimeout; // Seconds a client has to answer the PING
+    unsigned int registrationTimeout; // Seconds a connection has to authenticate (0 = no limit)
+    LogConfig log; // Applied by main() before the server starts
+    std::string recordPath; // Trace file for the inbound traffic (empty = no recording)
+
+    ServerConfig();
 };
 
 class Command;
@@ -27,30 +47,66 @@ class Server
     private:
         int _port; // Server listening port
         std::string _password; // Server password
-        int _serverSocket; // Server socket file descriptor
-        std::vector<pollfd> _pollFds; // Poll file descriptors || This vector tracks ALL file descriptors the server needs to monitor (server socket + all client sockets)
-        std::map<std::string, Channel*> _channels;// channel name → Channel object
-        std::map<int, Client*> _clients; // socket FD → Client object
-        std::map<std::string, Client*> _registeredNicknames; // nickname → Client object
+        ServerConfig _config;
+        bool _threaded; // More than one reactor: commands run on the core (main) thread
+        std::vector<Reactor*> _reactors; // Event loops owning the sockets
+        SymbolTable _channelNames; // Case-insensitive (RFC 1459), like nicknames
+        std::vector<Channel*> _channels; // By channel name symbol id, NULL where there is no channel
+        std::vector<Client*> _clients; // Indexed by socket FD, NULL where there is no client (owned by its reactor)
+        NickIndex _nicknames; // nickname → Client object, case-insensitive (RFC 1459)
+        Mailbox<CoreEvent> _coreInbox; // Threaded mode: parsed commands and disconnects from the reactors
+        std::vector<CoreEvent> _coreBatch; // Scratch space reused by runCore()
+        std::vector<std::vector<ReactorMessage> > _outboxes; // Threaded mode: replies per reactor, posted once per core iteration
+        volatile sig_atomic_t _stopRequested;
+        CoreMetrics _metrics; // Written by whichever thread runs commands
+        Arena _replyArena; // Reply lines built by command handlers, reset once per loop iteration
+        TraceWriter* _trace; // NULL unless recording
+        volatile unsigned long _nextConnectionId; // Shared by the reactors, bumped atomically
 
-        void setupServerSocket(); 
-        void acceptNewConnection();
-        void handleClientData(int ClientSocket);
+        void runCore();
+        void publishOutboxes();
 
     public:
-        Server(int port, const std::string& password);
+        Server(int port, const std::string& password, const ServerConfig& config = ServerConfig());
         ~Server();
         
         void run();
+        void requestStop();
+        bool isStopping() const;
+
+        // BACKEND_LOOPBACK: connects in-memory clients and runs the event loop one iteration at a time
+        Client* connectLoopback(LoopbackPeer* peer);
+        void runLoopback(const std::vector<Client*>& ready);
+        void advanceLoopbackClock(unsigned long ms); // Lets a test run keepalive and registration deadlines without sleeping
+
+        void postEvents(std::vector<CoreEvent>& batch);
+        void clientConnected(Client* client);
+        void clientLine(Client& client, const char* line, size_t length);
+        void clientCommand(Client& client, const CoreEvent& event);
+        void clientDisconnected(Client* client);
+        void clientRegistered(Client& client);
+
+        void sendToClient(Client& client, const std::string& message);
+        void sendToClient(Client& client, const MessageBuffer& message);
+        void broadcast(const Channel& channel, const std::string& message, const Client* except = NULL);
+        void broadcast(const Channel& channel, const MessageBuffer& message, const Client* except = NULL);
+        Arena& getReplyArena();
+        void resetReplyArena();
 
         bool manageNickname(const std::string &nickname, Client* client, NicknameOperation op);
 
         const std::string& getPassword() const;
         Channel* createOrGetChannel(const std::string& channelName);
         Channel* getChannel(const std::string& channelName);
-        const std::map<int, Client*>& getClients() const;
+        const std::vector<Client*>& getClients() const;
         Client* getClientByNickname(const std::string& nickname) const;
+        FlushStats getFlushStats() const;
+        FloodStats getFloodStats() const;
+        CoreMetrics& getMetrics();
+        LoopMetrics getLoopMetrics() const;
+        TraceWriter* getTrace() const;
+        unsigned long nextConnectionId();
         
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,58 @@
+#ifndef SYMBOLTABLE_HPP
+#define SYMBOLTABLE_HPP
+
+#include <string>
+#include <vector>
+
+// One interned name. The object and its id stay the same for as long as the name is
+// interned, renames included, so holders keep the pointer and compare ids, not strings.
+struct Symbol
+{
+    unsigned int id; // Index in the table, never SymbolTable::NO_SYMBOL while interned
+    std::string name; // As the owner spelled it
+    std::string prefix; // ":" + name, the source prefix of messages from a nick
+    unsigned int hash;
+
+    Symbol();
+};
+
+// Name → Symbol table with small, reused integer ids, so owners can sit in plain arrays indexed
+// by id. Names compare under RFC 1459 casemapping (A-Z = a-z, [ = {, ] = }, \ = |, ~ = ^), so
+// "Nick" and "nick" are the same name. Open addressing with linear probing; deletions
+// shift the following entries back instead of leaving tombstones, so probe chains stay short
+// under churn. Lookups fold characters on the fly and never allocate.
+class SymbolTable
+{
+    private:
+        std::vector<Symbol*> _symbols; // By id; entry 0 is unused. Released symbols wait in _freeIds
+        std::vector<unsigned int> _freeIds;
+        std::vector<Symbol*> _slots; // NULL marks an empty slot; size is always a power of two
+        size_t _count;
+
+        SymbolTable(const SymbolTable&);
+        SymbolTable& operator=(const SymbolTable&);
+
+        size_t findSlot(const std::string& name, unsigned int hash) const;
+        void insertSlot(Symbol* symbol);
+        void removeSlot(size_t index);
+        void grow();
+
+    public:
+        static const unsigned int NO_SYMBOL = 0;
+
+        SymbolTable();
+        ~SymbolTable();
+
+        static char fold(char c);
+        static unsigned int hash(const std::string& name);
+        static bool equals(const std::string& a, const std::string& b);
+
+        const Symbol* find(const std::string& name) const;
+        const Symbol* add(const std::string& name); // NULL if the name is taken
+        bool rename(const Symbol* symbol, const std::string& name); // Same id and object; false if another symbol has the name
+        void remove(const Symbol* symbol); // The id is handed out again by a later add()
+        size_t size() const;
+        size_t idLimit() const; // Every id is below this: the size for arrays indexed by id
+};
+
+#endif
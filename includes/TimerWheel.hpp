@@ -0,0 +1,55 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <vector>
+#include <cstddef>
+
+class Client;
+
+// Intrusive timer: embedded in its owner, so arming and cancelling never allocate
+struct Timer
+{
+    Timer* prev;
+    Timer* next; // NULL while not armed
+    unsigned long expires; // Tick the timer fires on
+    Client* client;
+    int kind; // What to do when it fires, interpreted by the owner of the wheel
+
+    Timer();
+    bool isArmed() const;
+};
+
+// Hierarchical timing wheel (Varghese & Lauck): LEVELS rings of SLOTS doubly-linked lists.
+// Level 0 holds the timers due within SLOTS ticks, each level above covers SLOTS times the span
+// of the one below, and its slots are cascaded down as the wheel turns. Scheduling and
+// cancelling are O(1) whatever the number of timers; advancing costs O(1) per tick plus
+// the timers that fire or move down a level.
+class TimerWheel
+{
+    private:
+        static const unsigned int LEVEL_BITS = 6;
+        static const size_t SLOTS = 1 << LEVEL_BITS;
+        static const size_t LEVELS = 4;
+
+        unsigned long _tickMs;
+        unsigned long _current; // Last tick processed by advance()
+        size_t _count;
+        Timer _slots[LEVELS][SLOTS]; // Sentinel heads of circular lists
+
+        TimerWheel(const TimerWheel&);
+        TimerWheel& operator=(const TimerWheel&);
+
+        void place(Timer& timer);
+        void cascade(size_t level, size_t slot);
+
+    public:
+        TimerWheel(unsigned long nowMs, unsigned long tickMs);
+
+        void schedule(Timer& timer, unsigned long whenMs); // Moves the timer if it is already armed
+        void cancel(Timer& timer);
+        void advance(unsigned long nowMs, std::vector<Timer*>& expired);
+        int msUntilNext(unsigned long nowMs) const; // -1 when no timer is armed
+        size_t size() const;
+};
+
+#endif
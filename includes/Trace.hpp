@@ -0,0 +1,61 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+// Inbound traffic trace, written by `ircserv --record=FILE` and read by the replay tool.
+//
+// File layout: the 8-byte magic "IRCTRACE", a version byte, then records of
+//     type         1 byte (TraceRecordType)
+//     time         varint, microseconds since recording started
+//     connection   varint, unique for the life of the server (fds are reused, these are not)
+//     TRACE_LINE:  varint length, then the line without its CR-LF
+// Varints are LEB128: 7 bits per byte, low bits first, high bit set on all but the last byte.
+// A PRIVMSG line costs about 5 bytes on top of its text.
+
+enum TraceRecordType {
+    TRACE_CONNECT = 1,
+    TRACE_LINE = 2,
+    TRACE_CLOSE = 3
+};
+
+struct TraceRecord
+{
+    TraceRecordType type;
+    unsigned long timeUs;
+    unsigned long connection;
+    std::string line; // TRACE_LINE only
+};
+
+// Shared by the reactors. Each one encodes its records into a batch of its own and hands the
+// batch over once per loop iteration, so the lock and the write() are per iteration, not per line.
+class TraceWriter
+{
+    private:
+        int _fd;
+        unsigned long _startNs; // Monotonic clock at time 0
+        pthread_mutex_t _mutex;
+
+        TraceWriter(const TraceWriter&);
+        TraceWriter& operator=(const TraceWriter&);
+
+    public:
+        static const char MAGIC[8];
+        static const unsigned char VERSION = 1;
+
+        TraceWriter(const std::string& path, unsigned long startNs);
+        ~TraceWriter();
+
+        unsigned long getStartNs() const;
+        // PASS lines are stored as "PASS *": traces get shared, passwords must not be
+        static void encode(std::string& batch, TraceRecordType type, unsigned long timeUs, unsigned long connection,
+                           const char* line = NULL, size_t length = 0);
+        void write(std::string& batch); // Appends the batch to the file and empties it
+};
+
+// Reads a whole trace into memory; throws std::runtime_error on a malformed file
+std::vector<TraceRecord> readTrace(const std::string& path);
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef TRANSPORT_HPP
+#define TRANSPORT_HPP
+
+#include <string>
+#include <cstddef>
+#include <sys/types.h> // for ssize_t
+#include <sys/uio.h> // for iovec
+
+// Byte stream under a Client. The reactor only ever talks to a client through one of these,
+// so the whole command pipeline runs the same over a TCP socket or over memory.
+// receive() and sendv() follow recv() and writev(): a byte count, 0 from receive() at the end
+// of the stream, or -1 with errno set (EAGAIN when nothing can be done right now).
+class Transport
+{
+    protected:
+        int _fd; // Socket, or a stand-in id that keys the fd-indexed tables and is never passed to the kernel
+
+        Transport(int fd);
+
+    private:
+        Transport(const Transport&);
+        Transport& operator=(const Transport&);
+
+    public:
+        virtual ~Transport();
+
+        int getFd() const;
+
+        virtual ssize_t receive(char* buffer, size_t length) = 0;
+        virtual ssize_t sendv(const iovec* iov, int count) = 0;
+        virtual void sendNow(const char* data, size_t length) = 0; // Best effort, never blocks
+        virtual void close() = 0;
+};
+
+class SocketTransport : public Transport
+{
+    public:
+        SocketTransport(int fd);
+
+        ssize_t receive(char* buffer, size_t length);
+        ssize_t sendv(const iovec* iov, int count);
+        void sendNow(const char* data, size_t length);
+        void close();
+};
+
+// The client's end of an in-memory connection, owned by whoever plays the clients (a test,
+// a benchmark, a simulation). It outlives the server's end, so closing is visible from here.
+class LoopbackPeer
+{
+    public:
+        enum OutputMode {
+            KEEP_OUTPUT, // Replies are kept until takeOutput()
+            DISCARD_OUTPUT, // Only counted
+            HASH_OUTPUT // Only counted and hashed (FNV-1a), to compare runs byte for byte
+        };
+
+        LoopbackPeer(OutputMode mode = KEEP_OUTPUT, size_t capacity = 0);
+
+        void send(const std::string& data); // Bytes for the server to read
+        void hangUp(); // The server reads the end of the stream once it has read everything sent
+        void reset(); // The connection fails, like a TCP reset: the server sees a hangup, and unread bytes are lost
+        bool hasInput() const;
+        std::string takeOutput();
+        unsigned long getBytesReceived() const;
+        unsigned long getOutputHash() const;
+        bool isClosed() const; // The server closed its end and freed the client
+
+    private:
+        friend class LoopbackTransport;
+
+        std::string _toServer;
+        size_t _readOffset; // Bytes of _toServer the server has read
+        bool _hungUp;
+        bool _reset;
+        std::string _fromServer; // KEEP_OUTPUT only
+        OutputMode _mode;
+        size_t _capacity; // Unread output that makes the server's writes block, like a full socket (0 = never). sendNow() goes past it, so a test sees the server's last words to a client it gives up on
+        unsigned long _bytesReceived;
+        unsigned long _hash;
+        bool _closed;
+};
+
+// The server's end of an in-memory connection
+class LoopbackTransport : public Transport
+{
+    private:
+        LoopbackPeer* _peer;
+
+        ssize_t write(const iovec* iov, int count, bool bounded); // bounded: stop at the peer's capacity
+
+    public:
+        LoopbackTransport(int id, LoopbackPeer* peer);
+
+        ssize_t receive(char* buffer, size_t length);
+        ssize_t sendv(const iovec* iov, int count);
+        void sendNow(const char* data, size_t length);
+        void close();
+        bool isReset() const;
+};
+
+#endif
@@ -11,12 +11,9 @@ Server* g_server = NULL;
 
 void signalHandler(int signal) {
     (void)signal;
-    std::cout << "\nShutting down server...\n";
-    if (g_server) {
-        delete g_server;
-        g_server = NULL;
-    }
-    exit(0);
+    // Reactor threads may be running: only flag the stop here, main() tears the server down
+    if (g_server)
+        g_server->requestStop();
 }
 
 int check_password(const char *pass)
@@ -31,9 +28,84 @@ int check_password(const char *pass)
     return 1;
 }
 
+int parse_option(const std::string& arg, ServerConfig& config)
+{
+    if (arg == "--backend=poll")
+        config.backend = BACKEND_POLL;
+    else if (arg == "--backend=epoll")
+        config.backend = BACKEND_EPOLL;
+    else if (arg.compare(0, 10, "--threads=") == 0) {
+        config.threads = atoi(arg.c_str() + 10);
+        if (config.threads < 1 || config.threads > 256)
+            return 0;
+    }
+    else if (arg.compare(0, 14, "--flood-burst=") == 0) {
+        int burst = atoi(arg.c_str() + 14);
+        if (burst < 1 || burst > 100000)
+            return 0;
+        config.flood.burst = burst;
+    }
+    else if (arg.compare(0, 13, "--flood-rate=") == 0) {
+        int rate = atoi(arg.c_str() + 13);
+        if (rate < 0 || rate > 100000)
+            return 0;
+        config.flood.rate = rate; // 0 turns flood control off
+    }
+    else if (arg.compare(0, 8, "--sendq=") == 0) {
+        long sendQ = atol(arg.c_str() + 8);
+        if (sendQ < 0 || (sendQ > 0 && sendQ < 512))
+            return 0;
+        config.sendQ = sendQ; // 0 means unlimited
+    }
+    else if (arg.compare(0, 16, "--ping-interval=") == 0) {
+        int seconds = atoi(arg.c_str() + 16);
+        if (seconds < 0 || seconds > 86400)
+            return 0;
+        config.pingInterval = seconds; // 0 turns the keepalive off
+    }
+    else if (arg.compare(0, 15, "--ping-timeout=") == 0) {
+        int seconds = atoi(arg.c_str() + 15);
+        if (seconds < 1 || seconds > 86400)
+            return 0;
+        config.pingTimeout = seconds;
+    }
+    else if (arg.compare(0, 19, "--register-timeout=") == 0) {
+        int seconds = atoi(arg.c_str() + 19);
+        if (seconds < 0 || seconds > 86400)
+            return 0;
+        config.registrationTimeout = seconds; // 0 means no limit
+    }
+    else if (arg.compare(0, 12, "--log-level=") == 0) {
+        if (!Log::parseLevel(arg.substr(12), config.log.level))
+            return 0;
+    }
+    else if (arg.compare(0, 13, "--log-sample=") == 0) {
+        // CATEGORY:N keeps one record in N of that category
+        size_t colon = arg.find(':', 13);
+        LogCategory category;
+        if (colon == std::string::npos || !Log::parseCategory(arg.substr(13, colon - 13), category))
+            return 0;
+        int every = atoi(arg.c_str() + colon + 1);
+        if (every < 1 || every > 1000000)
+            return 0;
+        config.log.sample[category] = every;
+    }
+    else if (arg.compare(0, 9, "--record=") == 0) {
+        config.recordPath = arg.substr(9);
+        if (config.recordPath.empty())
+            return 0;
+    }
+    else
+        return 0;
+    return 1;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: ./ircserv <port> <password>\n";
+    if (argc < 3) {
+        std::cerr << "Usage: ./ircserv <port> <password> [--backend=poll|epoll] [--threads=N] [--flood-burst=N] [--flood-rate=N] [--sendq=BYTES]\n"
+                  << "                 [--ping-interval=SECONDS] [--ping-timeout=SECONDS] [--register-timeout=SECONDS]\n"
+                  << "                 [--log-level=error|warn|info|debug|trace] [--log-sample=CATEGORY:N]\n"
+                  << "                 [--record=FILE]\n";
         return 1;
     }
 
@@ -51,20 +123,36 @@ int main(int argc, char* argv[]) {
     }
     
     std::string password = argv[2];
+
+    ServerConfig config;
+    for (int i = 3; i < argc; ++i) {
+        if (!parse_option(argv[i], config)) {
+            std::cerr << "Invalid option: " << argv[i] << "\n";
+            return 1;
+        }
+    }
     
     // Register signal handler for Ctrl+C
     signal(SIGINT, signalHandler);
+    // A peer closing mid-write must surface as EPIPE from writev(), not kill the server
+    signal(SIGPIPE, SIG_IGN);
     
     try {
-        g_server = new Server(port, password);
+        Log::start(config.log);
+        g_server = new Server(port, password, config);
         g_server->run();
+        if (Log::shouldLog(LOG_INFO, LOG_SERVER))
+            LogLine(LOG_INFO, LOG_SERVER) << "Shutting down server...";
+        delete g_server;
+        g_server = NULL;
     } catch (const std::exception &e) {
-        std::cerr << "Server error: " << e.what() << "\n";
+        LogLine(LOG_ERROR, LOG_SERVER) << "Server error: " << e.what();
         if (g_server) {
             delete g_server;
             g_server = NULL;
         }
     }
+    Log::stop(); // Reactor threads are gone: write out what they logged
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "../includes/Arena.hpp"
+#include <cstring> // for memcpy(), strlen()
+#include <new>
+
+ArenaStats::ArenaStats() : chunkSize(0), chunks(0), bytesReserved(0), allocations(0), resets(0), peakBytes(0), overflowChunks(0) {}
+
+Arena::Arena(size_t chunkSize) : _chunkSize(chunkSize), _chunks(NULL), _top(NULL), _end(NULL), _last(NULL), _used(0)
+{
+    _stats.chunkSize = chunkSize;
+}
+
+Arena::~Arena()
+{
+    while (_chunks) {
+        Chunk* next = _chunks->next;
+        ::operator delete(_chunks);
+        _chunks = next;
+    }
+}
+
+void Arena::addChunk(size_t minimum) // oversized requests get a chunk of their own size
+{
+    size_t size = (minimum > _chunkSize) ? minimum : _chunkSize;
+    Chunk* chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + size));
+    chunk->next = _chunks;
+    chunk->size = size;
+    if (_chunks)
+        _stats.overflowChunks++;
+    _chunks = chunk;
+    _top = reinterpret_cast<char*>(chunk + 1);
+    _end = _top + size;
+    _stats.chunks++;
+    _stats.bytesReserved += size;
+}
+
+char* Arena::allocate(size_t size)
+{
+    if (static_cast<size_t>(_end - _top) < size)
+        addChunk(size);
+    _last = _top;
+    _top += size;
+    _used += size;
+    if (_used > _stats.peakBytes)
+        _stats.peakBytes = _used;
+    _stats.allocations++;
+    return _last;
+}
+
+char* Arena::grow(char* block, size_t size, size_t newSize)
+{
+    if (block == _last && static_cast<size_t>(_end - block) >= newSize) {
+        _top = block + newSize;
+        _used += newSize - size;
+        if (_used > _stats.peakBytes)
+            _stats.peakBytes = _used;
+        return block;
+    }
+    char* moved = allocate(newSize);
+    memcpy(moved, block, size);
+    return moved;
+}
+
+void Arena::reset() // frees the overflow chunks, rewinds the first one
+{
+    _stats.resets++;
+    _used = 0;
+    _last = NULL;
+    if (!_chunks)
+        return;
+    while (_chunks->next) {
+        Chunk* next = _chunks->next;
+        _stats.chunks--;
+        _stats.bytesReserved -= _chunks->size;
+        ::operator delete(_chunks);
+        _chunks = next;
+    }
+    _top = reinterpret_cast<char*>(_chunks + 1);
+    _end = _top + _chunks->size;
+}
+
+ArenaStats Arena::getStats() const
+{
+    return _stats;
+}
+
+Reply::Reply(Arena& arena) : _arena(arena), _data(arena.allocate(INITIAL_CAPACITY)), _length(0), _capacity(INITIAL_CAPACITY) {}
+
+void Reply::reserve(size_t length)
+{
+    if (length <= _capacity)
+        return;
+    size_t capacity = _capacity * 2;
+    if (capacity < length)
+        capacity = length;
+    _data = _arena.grow(_data, _length, capacity);
+    _capacity = capacity;
+}
+
+Reply& Reply::append(const char* data, size_t length)
+{
+    reserve(_length + length);
+    memcpy(_data + _length, data, length);
+    _length += length;
+    return *this;
+}
+
+Reply& Reply::appendJoined(const MessageView& params, size_t from)
+{
+    for (size_t i = from; i < params.size(); ++i) {
+        if (i > from)
+            *this << ' ';
+        *this << params[i];
+    }
+    return *this;
+}
+
+Reply& Reply::operator<<(const char* text)
+{
+    return append(text, strlen(text));
+}
+
+Reply& Reply::operator<<(const std::string& text)
+{
+    return append(text.data(), text.length());
+}
+
+Reply& Reply::operator<<(const StringSlice& text)
+{
+    return append(text.data, text.len);
+}
+
+Reply& Reply::operator<<(char c)
+{
+    return append(&c, 1);
+}
+
+const char* Reply::data() const
+{
+    return _data;
+}
+
+size_t Reply::length() const
+{
+    return _length;
+}
+
+MessageBuffer Reply::message() const
+{
+    return MessageBuffer(_data, _length);
+}
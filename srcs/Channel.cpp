@@ -1,8 +1,50 @@
 #include "../includes/Channel.hpp"
+#include <sstream>
+#include <cstring>
+
+// Every mode MODE understands; unknown letters get ERR_UNKNOWNMODE
+const ModeDescriptor Channel::_modeTable[] = {
+    // letter  kind                            bit                 +arg   -arg   missing parameter text
+    { 'i', ModeDescriptor::CHANNEL_FLAG,   CMODE_INVITE_ONLY, false, false, NULL },
+    { 't', ModeDescriptor::CHANNEL_FLAG,   CMODE_TOPIC_LOCK,  false, false, NULL },
+    { 'k', ModeDescriptor::CHANNEL_KEY,    CMODE_KEY,         true,  false, "Missing key parameter for +k" },
+    { 'l', ModeDescriptor::CHANNEL_LIMIT,  CMODE_LIMIT,       true,  false, "Missing parameter for +l" },
+    { 'o', ModeDescriptor::MEMBER_STATUS,  MEMBER_OP,         true,  true,  "Missing nickname parameter for +o/-o" },
+};
+
+SlabPool Channel::_pool("Channel", sizeof(Channel), 128);
+
+const size_t Channel::NAME_MAX_LENGTH;
+
+static const size_t IRC_LINE_MAX = 512; // RFC 1459 message limit, CRLF included
+static const size_t NICK_MAX_LENGTH = 9; // Longest nickname NICK accepts
+
+Channel::Channel(const std::string& name) : _name(name), _topic(""), _operatorCount(0), _modes(0), _key(""), _userLimit(0), _modeString("+"), _namesValid(false) {}
+
+// Members and invitees still listed here get their back-reference dropped so they never point at a deleted channel
+Channel::~Channel() {
+    for (size_t i = 0; i < _members.size(); ++i)
+        _members[i].client->leftChannel(this);
+    for (std::set<Client*>::iterator it = _invited.begin(); it != _invited.end(); ++it)
+        (*it)->invitationDropped(this);
+}
 
-Channel::Channel(const std::string& name) : _name(name), _topic(""), _key(""), _userLimit(0) {}
+void* Channel::operator new(size_t size) {
+    if (size != sizeof(Channel)) // Not a Channel-sized slot
+        return ::operator new(size);
+    return _pool.allocate();
+}
 
-Channel::~Channel() {}
+void Channel::operator delete(void* channel, size_t size) {
+    if (size != sizeof(Channel))
+        ::operator delete(channel);
+    else
+        _pool.release(channel);
+}
+
+PoolStats Channel::getPoolStats() {
+    return _pool.getStats();
+}
 
 const std::string& Channel::getName() const {
     return _name;
@@ -16,105 +58,191 @@ void Channel::setTopic(const std::string& topic) {
     _topic = topic;
 }
 
+ChannelMember* Channel::findMember(Client* client) {
+    size_t slot = client->getChannelSlot(this);
+    if (slot == Client::NOT_MEMBER)
+        return NULL;
+    return &_members[slot];
+}
+
+const ChannelMember* Channel::findMember(Client* client) const {
+    size_t slot = client->getChannelSlot(const_cast<Channel*>(this));
+    if (slot == Client::NOT_MEMBER)
+        return NULL;
+    return &_members[slot];
+}
+
 void Channel::addClient(Client* client) {
-    _clients.insert(client);
-}
-
-void Channel::removeClient(const std::string& nickname) {
-    for (std::set<Client*>::iterator it = _clients.begin(); it != _clients.end(); ++it) {
-        if ((*it)->getNickname() == nickname) {
-            if (isOperator(*it)) {
-                removeOperator(*it);
-            }
-            _clients.erase(it);
-            return;
-        }
-    }
+    if (findMember(client))
+        return;
+    ChannelMember member;
+    member.client = client;
+    member.flags = 0;
+    _members.push_back(member);
+    client->setChannelSlot(this, _members.size() - 1);
+    if (_namesValid)
+        appendName(member);
 }
 
-bool Channel::hasClient(const std::string& nickname) const {
-    for (std::set<Client*>::const_iterator it = _clients.begin(); it != _clients.end(); ++it) {
-        if ((*it)->getNickname() == nickname)
-            return true;
+void Channel::removeClient(Client* client) {
+    size_t slot = client->getChannelSlot(this);
+    if (slot == Client::NOT_MEMBER)
+        return;
+    if (_members[slot].flags & MEMBER_OP)
+        --_operatorCount;
+
+    // Swap-remove: the last row fills the hole and its client learns the new slot
+    size_t last = _members.size() - 1;
+    if (slot != last) {
+        _members[slot] = _members[last];
+        _members[slot].client->setChannelSlot(this, slot);
     }
-    return false;
+    _members.pop_back();
+    client->leftChannel(this);
+    _namesValid = false;
 }
 
-void Channel::setOperator(const std::string& nickname) {
-    for (std::set<Client*>::iterator it = _clients.begin(); it != _clients.end(); ++it) {
-        if ((*it)->getNickname() == nickname) {
-            _operators.insert(*it);
-            return;
-        }
-    }
+bool Channel::hasClient(Client* client) const {
+    return findMember(client) != NULL;
 }
 
-const std::string& Channel::getOperator() const {
-    static std::string empty = "";
-    if (_operators.empty())
-        return empty;
-    return (*_operators.begin())->getNickname();
+void Channel::setOperator(Client* client) {
+    ChannelMember* member = findMember(client);
+    if (!member || (member->flags & MEMBER_OP))
+        return;
+    member->flags |= MEMBER_OP;
+    ++_operatorCount;
+    _namesValid = false;
 }
 
 bool Channel::isOperator(Client* client) const {
-    return _operators.find(client) != _operators.end();
+    const ChannelMember* member = findMember(client);
+    return member && (member->flags & MEMBER_OP);
 }
 
-bool Channel::isOperator(const std::string& nickname) const {
-    for (std::set<Client*>::const_iterator it = _operators.begin(); it != _operators.end(); ++it) {
-        if ((*it)->getNickname() == nickname)
-            return true;
-    }
-    return false;
+void Channel::removeOperator(Client* client) {
+    ChannelMember* member = findMember(client);
+    if (!member || !(member->flags & MEMBER_OP))
+        return;
+    member->flags &= ~MEMBER_OP;
+    --_operatorCount;
+    _namesValid = false;
 }
 
-void Channel::removeOperator(Client* client) {
-    _operators.erase(client);
+bool Channel::hasOperators() const {
+    return _operatorCount > 0;
 }
 
 bool Channel::isInviteOnly() const {
-    return hasMode('i');
+    return (_modes & CMODE_INVITE_ONLY) != 0;
 }
 
+// The invitee keeps the reverse link, so its invitations can be dropped when it disconnects
 void Channel::addInvitation(Client* client) {
-    _invited.insert(client);
+    if (_invited.insert(client).second)
+        client->invitedTo(this);
 }
 
 void Channel::removeInvitation(Client* client) {
-    _invited.erase(client);
+    if (_invited.erase(client))
+        client->invitationDropped(this);
 }
 
 bool Channel::isInvited(Client* client) const {
     return _invited.find(client) != _invited.end();
 }
 
-const std::set<Client*>& Channel::getClients() const {
-    return _clients;
+const std::vector<ChannelMember>& Channel::getMembers() const {
+    return _members;
 }
 
-void Channel::addMode(char mode) {
-    _modes.insert(mode);
+size_t Channel::getMemberCount() const {
+    return _members.size();
 }
 
-void Channel::removeMode(char mode) {
-    _modes.erase(mode);
-}   
+// Space left for names in ":ircserv 353 <nick> = <channel> :<names>\r\n" with a
+// maximum-length requester nick, so every cached chunk fits a 512-byte line. With the
+// channel name capped at NAME_MAX_LENGTH there is always room for at least one nick.
+size_t Channel::namesBudget() const {
+    const size_t fixed = strlen(":ircserv 353 ") + NICK_MAX_LENGTH + strlen(" = ") + _name.length() + strlen(" :") + strlen("\r\n");
+    return (fixed < IRC_LINE_MAX) ? IRC_LINE_MAX - fixed : 0;
+}
+
+// Rebuilt only after a part, a prefix change or a member rename; between those every
+// JOIN and NAMES reuses the same chunks
+const std::vector<std::string>& Channel::getNamesChunks() const {
+    if (_namesValid)
+        return _namesChunks;
+
+    _namesChunks.clear();
+    for (size_t i = 0; i < _members.size(); ++i)
+        appendName(_members[i]);
+    _namesValid = true;
+    return _namesChunks;
+}
+
+// Adds one member to the last chunk, opening a new chunk when it would overflow.
+// A join only appends, so a valid cache stays valid through a join storm.
+void Channel::appendName(const ChannelMember& member) const {
+    const std::string& nickname = member.client->getNickname();
+    size_t length = nickname.length() + ((member.flags & MEMBER_OP) ? 1 : 0);
+    if (_namesChunks.empty() || _namesChunks.back().length() + 1 + length > namesBudget())
+        _namesChunks.push_back(std::string());
+
+    std::string& chunk = _namesChunks.back();
+    if (!chunk.empty())
+        chunk += ' ';
+    if (member.flags & MEMBER_OP)
+        chunk += '@';
+    chunk += nickname;
+}
+
+void Channel::invalidateNames() {
+    _namesValid = false;
+}
 
-bool Channel::hasMode(char mode) const {
-    return _modes.find(mode) != _modes.end();
+const ModeDescriptor* Channel::findMode(char letter) {
+    for (size_t i = 0; i < sizeof(_modeTable) / sizeof(_modeTable[0]); ++i) {
+        if (_modeTable[i].letter == letter)
+            return &_modeTable[i];
+    }
+    return NULL;
+}
+
+void Channel::setMode(ChannelMode mode, bool enabled) {
+    unsigned int modes = enabled ? (_modes | mode) : (_modes & ~mode);
+    if (modes == _modes)
+        return;
+    _modes = modes;
+    updateModeString();
 }
 
-std::string Channel::getModes() const {
-    std::string modes;
-    for (std::set<char>::const_iterator it = _modes.begin(); it != _modes.end(); ++it) {
-        modes += *it;
+bool Channel::hasMode(ChannelMode mode) const {
+    return (_modes & mode) != 0;
+}
+
+// Letters in table order, then the limit; the key is not shown to keep it private
+void Channel::updateModeString() {
+    _modeString = "+";
+    for (size_t i = 0; i < sizeof(_modeTable) / sizeof(_modeTable[0]); ++i) {
+        const ModeDescriptor& desc = _modeTable[i];
+        if (desc.kind != ModeDescriptor::MEMBER_STATUS && (_modes & desc.bit))
+            _modeString += desc.letter;
+    }
+    if (_modes & CMODE_LIMIT) {
+        std::ostringstream limit;
+        limit << _userLimit;
+        _modeString += " " + limit.str();
     }
-    return modes;
 }
 
+const std::string& Channel::getModeString() const {
+    return _modeString;
+}
 
 void Channel::setKey(const std::string& key) {
     _key = key;
+    setMode(CMODE_KEY, !_key.empty());
 }
 
 const std::string& Channel::getKey() const {
@@ -123,14 +251,17 @@ const std::string& Channel::getKey() const {
 
 void Channel::removeKey() {
     _key.clear();
+    setMode(CMODE_KEY, false);
 }
 
 bool Channel::hasKey() const {
-    return !_key.empty();
+    return (_modes & CMODE_KEY) != 0;
 }
 
 void Channel::setClientLimit(size_t limit) {
     _userLimit = limit;
+    _modes = limit ? (_modes | CMODE_LIMIT) : (_modes & ~CMODE_LIMIT);
+    updateModeString(); // The limit value is part of the string even if the bit did not change
 }
 
 size_t Channel::getClientLimit() const {
@@ -138,15 +269,15 @@ size_t Channel::getClientLimit() const {
 }
 
 void Channel::removeClientLimit() {
-    _userLimit = 0;
+    setClientLimit(0);
 }
 
 bool Channel::hasClientLimit() const {
-    return _userLimit > 0;
+    return (_modes & CMODE_LIMIT) != 0;
 }
 
 bool Channel::isFull() const {
-    return hasClientLimit() && _clients.size() >= _userLimit;
+    return hasClientLimit() && _members.size() >= _userLimit;
 }
 
 
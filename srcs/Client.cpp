@@ -1,27 +1,137 @@
 #include "../includes/Client.hpp"
+#include <cerrno>
+#include <cstring> // for memcpy()
 
-Client::Client(int socketFd, const std::string& ipAddr) : _socketFd(socketFd), _ipAddr(ipAddr), _nickname(""), _username(""), _realname(""), _buffer(""), _hasSentPass(false), _hasSentNick(false), _hasSentUser(false), _isRegistered(false), _isAuthenticated(false) {}
+#define FLUSH_MAX_IOV 256 // Messages gathered into a single writev()
+#define OUTQUEUE_KEEP 256 // Queue slots a drained client keeps for its next replies; a burst's larger queue is freed
 
-Client::~Client() {}
+static const std::string DEFAULT_QUIT_REASON = "Client disconnected";
+static const std::string NO_NICKNAME = "";
+static const std::string NO_PREFIX = ":";
+
+const size_t Client::NOT_MEMBER;
+
+SlabPool Client::_pool("Client", sizeof(Client), 128);
+
+FlushStats::FlushStats() : writeCalls(0), messagesWritten(0), bytesWritten(0), sendQEvictions(0) {}
+
+unsigned long FlushStats::syscallsSaved() const
+{
+    return messagesWritten > writeCalls ? messagesWritten - writeCalls : 0;
+}
+
+FloodPolicy::FloodPolicy() : burst(20), rate(10) {}
+
+bool FloodPolicy::enabled() const
+{
+    return rate > 0;
+}
+
+FloodStats::FloodStats() : throttledLines(0), maxDelayMs(0) {}
+
+TokenBucket::TokenBucket() : tokens(0), lastRefill(0), started(false) {}
+
+void TokenBucket::refill(unsigned long now, const FloodPolicy& policy)
+{
+    const unsigned long full = policy.burst * 1000UL;
+    if (!started) {
+        started = true;
+        tokens = full;
+    } else if (now > lastRefill) {
+        tokens += (now - lastRefill) * policy.rate; // rate lines/s = rate thousandths per ms
+        if (tokens > full)
+            tokens = full;
+    }
+    lastRefill = now;
+}
+
+bool TokenBucket::hasToken() const
+{
+    return tokens >= 1000;
+}
+
+void TokenBucket::take()
+{
+    tokens = (tokens >= 1000) ? tokens - 1000 : 0;
+}
+
+unsigned long TokenBucket::msUntilToken(const FloodPolicy& policy) const
+{
+    if (tokens >= 1000 || policy.rate == 0)
+        return 0;
+    return (1000 - tokens + policy.rate - 1) / policy.rate;
+}
+
+Client::Client(Transport* transport, const std::string& ipAddr) : _transport(transport), _ipAddr(ipAddr), _nickname(NULL), _userInfo(NULL), _hasSentPass(false), _hasSentNick(false), _hasSentUser(false), _isRegistered(false), _isAuthenticated(false), _outHead(0), _outOffset(0), _outBytes(0), _flushScheduled(false), _writeArmed(false), _reactor(NULL), _closing(false), _throttled(false), _throttledSince(0), _readBlocked(false), _backlogged(false), _evicting(false), _lastActivity(0), _pingSentAt(0), _connectionId(0)
+{
+    _keepaliveTimer.client = this;
+    _registrationTimer.client = this;
+}
+
+Client::~Client()
+{
+    delete[] _userInfo;
+    delete _transport;
+}
+
+void* Client::operator new(size_t size)
+{
+    if (size != sizeof(Client)) // Not a Client-sized slot
+        return ::operator new(size);
+    return _pool.allocate();
+}
+
+void Client::operator delete(void* client, size_t size)
+{
+    if (size != sizeof(Client))
+        ::operator delete(client);
+    else
+        _pool.release(client);
+}
+
+PoolStats Client::getPoolStats()
+{
+    return _pool.getStats();
+}
 
 int Client::getSocketFd() const
 {
-    return _socketFd;
+    return _transport->getFd();
+}
+
+Transport& Client::getTransport()
+{
+    return *_transport;
+}
+
+const std::string& Client::getIpAddr() const
+{
+    return _ipAddr;
 }
 
 const std::string& Client::getNickname() const
+{
+    return _nickname ? _nickname->name : NO_NICKNAME;
+}
+
+const std::string& Client::getPrefix() const
+{
+    return _nickname ? _nickname->prefix : NO_PREFIX;
+}
+
+const Symbol* Client::getNicknameSymbol() const
 {
     return _nickname;
 }
 
-const std::string& Client::getUsername() const
+const char* Client::getUsername() const
 {
-    return _username;
+    return _userInfo ? _userInfo : "";
 }
 
-const std::string& Client::getRealname() const
+const char* Client::getRealname() const
 {
-    return _realname;
+    return _userInfo ? _userInfo + strlen(_userInfo) + 1 : "";
 }
 
 bool Client::isReg() const
@@ -64,19 +174,20 @@ void Client::HasSentUser(bool status)
     _hasSentUser = status;
 }
 
-void Client::setNickname(const std::string& nickname)
+void Client::setNickname(const Symbol* nickname)
 {
     _nickname = nickname;
 }
 
-void Client::setUsername(const std::string& username)
-{
-    _username = username;
-}
-
-void Client::setRealname(const std::string& realname)
+void Client::setUserInfo(const StringSlice& username, const StringSlice& realname) // both in one exact-size block
 {
-    _realname = realname;
+    char* info = new char[username.len + realname.len + 2];
+    memcpy(info, username.data, username.len);
+    info[username.len] = '\0';
+    memcpy(info + username.len + 1, realname.data, realname.len);
+    info[username.len + 1 + realname.len] = '\0';
+    delete[] _userInfo;
+    _userInfo = info;
 }
 
 void Client::setReg(bool status)
@@ -89,17 +200,329 @@ void Client::setAuth(bool status)
     _isAuthenticated = status;
 }
 
-std::string& Client::getBuffer()
+InputBuffer& Client::getInput()
+{
+    return _input;
+}
+
+void Client::queueMessage(const MessageBuffer& message)
+{
+    if (!message.empty()) {
+        if (_outQueue.size() == _outQueue.capacity())
+            makeOutputRoom();
+        _outQueue.push_back(message);
+        _outBytes += message.length();
+    }
+}
+
+bool Client::hasPendingOutput() const
+{
+    return _outHead < _outQueue.size();
+}
+
+size_t Client::getQueuedBytes() const
+{
+    return _outBytes;
+}
+
+// Drops everything still queued and makes one best-effort attempt to tell the client why.
+// A message cut off mid-line is terminated first so the farewell parses as its own line.
+void Client::abortOutput(const std::string& farewell)
+{
+    std::string last = (_outOffset > 0) ? "\r\n" + farewell : farewell;
+    _transport->sendNow(last.data(), last.length());
+    std::vector<MessageBuffer>().swap(_outQueue);
+    _outHead = 0;
+    _outOffset = 0;
+    _outBytes = 0;
+}
+
+// The queue is full. Unwritten entries move to the front when at least half of it is spent,
+// or else to a queue twice the size, so it holds at most twice what is pending. Handles are
+// swapped, not copied: the shared counts are left alone.
+void Client::makeOutputRoom()
 {
-    return _buffer;
+    size_t pending = _outQueue.size() - _outHead;
+    if (_outHead > 0 && _outHead * 2 >= _outQueue.size()) {
+        for (size_t i = 0; i < pending; ++i)
+            _outQueue[i].swap(_outQueue[_outHead + i]);
+        _outQueue.resize(pending);
+    } else {
+        std::vector<MessageBuffer> larger;
+        larger.reserve(_outQueue.capacity() < 4 ? 4 : _outQueue.capacity() * 2);
+        larger.resize(pending);
+        for (size_t i = 0; i < pending; ++i)
+            larger[i].swap(_outQueue[_outHead + i]);
+        _outQueue.swap(larger);
+    }
+    _outHead = 0;
 }
 
-void Client::appendToBuffer(const std::string& data)
+void Client::releaseIdleOutput()
 {
-    _buffer += data;
+    if (_outHead == _outQueue.size()) {
+        std::vector<MessageBuffer>().swap(_outQueue);
+        _outHead = 0;
+    }
 }
 
-void Client::clearBuffer()
+// Writes as much of the queue as the socket accepts, gathering queued messages
+// into one writev() instead of a send() each. A partial write keeps its offset so
+// the next call resumes mid-message. Returns false on a fatal socket error.
+bool Client::flushOutput(FlushStats& stats)
 {
-    _buffer.clear();
-}
\ No newline at end of file
+    while (_outHead < _outQueue.size())
+    {
+        struct iovec iov[FLUSH_MAX_IOV];
+        int count = 0;
+        size_t requested = 0;
+        for (size_t i = _outHead; i < _outQueue.size() && count < FLUSH_MAX_IOV; ++i, ++count) {
+            size_t skip = (count == 0) ? _outOffset : 0;
+            iov[count].iov_base = const_cast<char*>(_outQueue[i].data() + skip);
+            iov[count].iov_len = _outQueue[i].length() - skip;
+            requested += iov[count].iov_len;
+        }
+
+        ssize_t written = _transport->sendv(iov, count);
+        if (written < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        stats.writeCalls++;
+        stats.bytesWritten += written;
+        _outBytes -= written;
+
+        size_t left = written;
+        while (left > 0) {
+            size_t remaining = _outQueue[_outHead].length() - _outOffset;
+            if (left < remaining) {
+                _outOffset += left;
+                break;
+            }
+            left -= remaining;
+            _outQueue[_outHead++] = MessageBuffer(); // Drops this client's reference to the shared payload
+            _outOffset = 0;
+            stats.messagesWritten++;
+        }
+        if (_outHead == _outQueue.size()) { // Drained: slots are reused until the client goes quiet (releaseIdleOutput())
+            if (_outQueue.capacity() > OUTQUEUE_KEEP)
+                std::vector<MessageBuffer>().swap(_outQueue);
+            else
+                _outQueue.clear();
+            _outHead = 0;
+        }
+
+        if (static_cast<size_t>(written) < requested)
+            return true; // Kernel buffer is full, wait for the next writable event
+    }
+    return true;
+}
+
+bool Client::isFlushScheduled() const
+{
+    return _flushScheduled;
+}
+
+void Client::setFlushScheduled(bool status)
+{
+    _flushScheduled = status;
+}
+
+bool Client::isWriteArmed() const
+{
+    return _writeArmed;
+}
+
+void Client::setWriteArmed(bool status)
+{
+    _writeArmed = status;
+}
+
+Reactor* Client::getReactor() const
+{
+    return _reactor;
+}
+
+void Client::setReactor(Reactor* reactor)
+{
+    _reactor = reactor;
+}
+
+bool Client::isClosing() const
+{
+    return _closing;
+}
+
+void Client::setClosing(bool status)
+{
+    _closing = status;
+}
+
+void Client::setChannelSlot(Channel* channel, size_t slot)
+{
+    for (size_t i = 0; i < _channels.size(); ++i) {
+        if (_channels[i].channel == channel) {
+            _channels[i].slot = slot;
+            return;
+        }
+    }
+    ChannelLink link;
+    link.channel = channel;
+    link.slot = slot;
+    _channels.push_back(link);
+}
+
+void Client::leftChannel(Channel* channel) // swap-removes the link, order does not matter
+{
+    for (size_t i = 0; i < _channels.size(); ++i) {
+        if (_channels[i].channel == channel) {
+            _channels[i] = _channels.back();
+            _channels.pop_back();
+            return;
+        }
+    }
+}
+
+size_t Client::getChannelSlot(Channel* channel) const
+{
+    for (size_t i = 0; i < _channels.size(); ++i) {
+        if (_channels[i].channel == channel)
+            return _channels[i].slot;
+    }
+    return NOT_MEMBER;
+}
+
+bool Client::isInChannel(Channel* channel) const
+{
+    return getChannelSlot(channel) != NOT_MEMBER;
+}
+
+const std::vector<ChannelLink>& Client::getChannels() const
+{
+    return _channels;
+}
+
+void Client::invitedTo(Channel* channel)
+{
+    _invitations.push_back(channel);
+}
+
+void Client::invitationDropped(Channel* channel)
+{
+    for (size_t i = 0; i < _invitations.size(); ++i) {
+        if (_invitations[i] == channel) {
+            _invitations[i] = _invitations.back();
+            _invitations.pop_back();
+            return;
+        }
+    }
+}
+
+const std::vector<Channel*>& Client::getInvitations() const
+{
+    return _invitations;
+}
+
+TokenBucket& Client::getBucket()
+{
+    return _bucket;
+}
+
+bool Client::isThrottled() const
+{
+    return _throttled;
+}
+
+void Client::setThrottled(bool status, unsigned long since)
+{
+    _throttled = status;
+    _throttledSince = since;
+}
+
+unsigned long Client::getThrottledSince() const
+{
+    return _throttledSince;
+}
+
+bool Client::isReadBlocked() const
+{
+    return _readBlocked;
+}
+
+void Client::setReadBlocked(bool status)
+{
+    _readBlocked = status;
+}
+
+bool Client::isBacklogged() const
+{
+    return _backlogged;
+}
+
+void Client::setBacklogged(bool status)
+{
+    _backlogged = status;
+}
+
+bool Client::isEvicting() const
+{
+    return _evicting;
+}
+
+void Client::setEvicting(bool status)
+{
+    _evicting = status;
+}
+
+const std::string& Client::getQuitReason() const
+{
+    return _quitReason.empty() ? DEFAULT_QUIT_REASON : _quitReason;
+}
+
+void Client::setQuitReason(const std::string& reason)
+{
+    _quitReason = reason;
+}
+
+Timer& Client::getKeepaliveTimer()
+{
+    return _keepaliveTimer;
+}
+
+Timer& Client::getRegistrationTimer()
+{
+    return _registrationTimer;
+}
+
+unsigned long Client::getLastActivity() const
+{
+    return _lastActivity;
+}
+
+void Client::setLastActivity(unsigned long now)
+{
+    _lastActivity = now;
+}
+
+unsigned long Client::getPingSentAt() const
+{
+    return _pingSentAt;
+}
+
+void Client::setPingSentAt(unsigned long now)
+{
+    _pingSentAt = now;
+}
+
+unsigned long Client::getConnectionId() const
+{
+    return _connectionId;
+}
+
+void Client::setConnectionId(unsigned long id)
+{
+    _connectionId = id;
+}
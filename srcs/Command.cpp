@@ -1,111 +1,162 @@
 #include "../includes/Command.hpp"
 #include <iostream>
+#include <sstream>
+
+// One entry per command: handler plus the checks every handler used to repeat.
+// Adding a command means adding a row here; the lookup table below is built from it.
+const CommandSpec Command::_commands[] = {
+    // name            handler                 min  max                       flags
+    { "PASS",          &Command::PASS,          1,  1,                        0 },
+    { "NICK",          &Command::NICK,          0,  MessageView::MAX_PARAMS,  0 }, // 431 handled by NICK itself
+    { "USER",          &Command::USER,          4,  4,                        0 },
+    { "AUTHENTICATE",  &Command::AUTHENTICATE,  0,  MessageView::MAX_PARAMS,  0 },
+    { "JOIN",          &Command::JOIN,          1,  2,                        CMD_NEEDS_AUTH },
+    { "KICK",          &Command::KICK,          2,  MessageView::MAX_PARAMS,  CMD_NEEDS_AUTH },
+    { "INVITE",        &Command::INVITE,        2,  2,                        CMD_NEEDS_AUTH },
+    { "TOPIC",         &Command::TOPIC,         1,  MessageView::MAX_PARAMS,  CMD_NEEDS_AUTH },
+    { "MODE",          &Command::MODE,          1,  MessageView::MAX_PARAMS,  CMD_NEEDS_AUTH },
+    { "PRIVMSG",       &Command::PRIVMSG,       0,  MessageView::MAX_PARAMS,  CMD_NEEDS_AUTH }, // 411/412 handled by PRIVMSG itself
+    { "NOTICE",        &Command::NOTICE,        2,  MessageView::MAX_PARAMS,  CMD_NEEDS_AUTH | CMD_SILENT },
+    { "NAMES",         &Command::NAMES,         0,  1,                        CMD_NEEDS_AUTH },
+    { "PING",          &Command::PING,          0,  MessageView::MAX_PARAMS,  0 }, // 409 handled by PING itself
+    { "PONG",          &Command::PONG,          0,  MessageView::MAX_PARAMS,  CMD_SILENT },
+    { "STATS",         &Command::STATS,         1,  2,                        CMD_NEEDS_AUTH },
+};
+
+const CommandSpec* Command::_slots[Command::SLOT_COUNT];
+bool Command::_tableBuilt = false;
+
+// FNV-1a over the command bytes; commands are short, so this is a handful of multiplies
+unsigned int Command::hashName(const char* name, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
 
-void Command::executeCommand(const std::string& commandLine, Client& client, Server& server) {
+// Open addressing with linear probing, sized well above the command count so probes stay short
+void Command::buildDispatchTable() {
+    const size_t count = sizeof(_commands) / sizeof(_commands[0]);
+    if (count >= SLOT_COUNT / 2 || count > CoreMetrics::MAX_COMMANDS)
+        throw std::runtime_error("Command dispatch table is too small");
+
+    for (size_t i = 0; i < SLOT_COUNT; ++i)
+        _slots[i] = NULL;
+    for (size_t i = 0; i < count; ++i) {
+        const CommandSpec& spec = _commands[i];
+        size_t slot = hashName(spec.name, strlen(spec.name)) & (SLOT_COUNT - 1);
+        while (_slots[slot])
+            slot = (slot + 1) & (SLOT_COUNT - 1);
+        _slots[slot] = &spec;
+    }
+    _tableBuilt = true;
+}
 
-    std::vector<std::string> tokens;
-    size_t pos = 0;
-    
-    // Parse tokens, handling colon-prefixed trailing parameters (IRC protocol)
-    while (pos < commandLine.length()) {
-        // Skip leading spaces
-        while (pos < commandLine.length() && commandLine[pos] == ' ')
-            pos++;
-        
-        if (pos >= commandLine.length())
-            break;
-            
-        // Check for trailing parameter (starts with :)
-        // Everything after : is treated as a single parameter
-        if (commandLine[pos] == ':') {
-            // Skip the colon and add everything remaining as one token
-            std::string trailing = commandLine.substr(pos + 1);
-            if (!trailing.empty())
-                tokens.push_back(trailing);
-            break;
+const CommandSpec* Command::findCommand(const char* name, size_t length) {
+    if (!_tableBuilt)
+        buildDispatchTable();
+
+    size_t slot = hashName(name, length) & (SLOT_COUNT - 1);
+    while (_slots[slot]) {
+        const CommandSpec* spec = _slots[slot];
+        if (strncmp(spec->name, name, length) == 0 && spec->name[length] == '\0')
+            return spec;
+        slot = (slot + 1) & (SLOT_COUNT - 1);
+    }
+    return NULL;
+}
+
+void Command::executeCommand(const char* line, size_t length, Client& client, Server& server) {
+    MessageView params;
+    const CommandSpec* spec;
+    if (parseCommand(line, length, params, spec))
+        runCommand(params, spec, length, client, server);
+}
+
+// Parse in place: prefix, command and parameters all point into the line. Reads nothing but
+// the dispatch table, built before any reactor thread starts, so it runs on any thread.
+bool Command::parseCommand(const char* line, size_t length, MessageView& message, const CommandSpec*& spec) {
+    if (!message.parse(line, length))
+        return false;
+    const StringSlice& command = message.command();
+    spec = findCommand(command.data, command.len);
+    return true;
+}
+
+void Command::runCommand(const MessageView& params, const CommandSpec* spec, size_t length, Client& client, Server& server) {
+    CoreMetrics& metrics = server.getMetrics();
+    if (!spec) {
+        metrics.unknownCommands++;
+        Reply error(server.getReplyArena());
+        error << ":ircserv 421 * " << params.command() << " :Unknown command\r\n";
+        server.sendToClient(client, error.message());
+        return;
+    }
+
+    CommandMetrics& stats = metrics.commands[spec - _commands];
+    stats.calls++;
+    stats.bytes += length;
+
+    // Checks shared by every command, before its handler runs. Registration comes first: an
+    // unregistered client gets 451 for every gated command whatever its parameters, never 461.
+    const std::string target = client.getNickname().empty() ? "*" : client.getNickname();
+    if ((spec->flags & CMD_NEEDS_AUTH) && !client.isAuth()) {
+        if (!(spec->flags & CMD_SILENT)) {
+            Reply error(server.getReplyArena());
+            error << ":ircserv 451 " << target << " :You have not registered\r\n";
+            server.sendToClient(client, error.message());
         }
-        
-        // Find next space
-        size_t found = commandLine.find(' ', pos);
-        if (found == std::string::npos) {
-            // No more spaces, add remaining string
-            tokens.push_back(commandLine.substr(pos));
-            break;
+        return;
+    }
+    if (params.size() < spec->minParams || params.size() > spec->maxParams) {
+        if (!(spec->flags & CMD_SILENT)) {
+            Reply error(server.getReplyArena());
+            error << ":ircserv 461 " << target << ' ' << spec->name << " :Not enough parameters\r\n";
+            server.sendToClient(client, error.message());
         }
-        
-        // Add token from pos to found
-        tokens.push_back(commandLine.substr(pos, found - pos));
-        pos = found;
-    }
-
-    if (tokens.empty()) return;
-
-    std::string command = tokens[0];
-    std::vector<std::string> params(tokens.begin() + 1, tokens.end());
-
-    if (command == "PASS") {
-        PASS(params, client, server);
-    } else if (command == "NICK") {
-        NICK(params, client, server);
-    } else if (command == "USER") {
-        USER(params, client, server);
-    } else if (command == "AUTHENTICATE") {
-        AUTHENTICATE(client, server);
-    } else if (command == "JOIN") {
-        JOIN(params, client, server);
-    } else if (command == "KICK") {
-        KICK(params, client, server);
-    } else if (command == "INVITE") {
-        INVITE(params, client, server);
-    } else if (command == "TOPIC") {
-        TOPIC(params, client, server);
-    } else if (command == "MODE") {
-        MODE(params, client, server);
-    } else if (command == "PRIVMSG") {
-        PRIVMSG(params, client, server);
-    } else if (command == "NOTICE") {
-        NOTICE(params, client, server);
+        return;
     }
-    else {
-        std::string error = ":ircserv 421 * " + command + " :Unknown command\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+
+    if (stats.calls % CommandMetrics::TIMING_SAMPLE != 1) { // Two clock reads cost about as much as a short handler
+        spec->handler(params, client, server);
+        return;
     }
+    unsigned long start = monotonicNs();
+    spec->handler(params, client, server);
+    stats.handlerNs.record(monotonicNs() - start);
 }
 
-void Command::AUTHENTICATE(Client& client, Server& server) {
-        (void)server;
+void Command::AUTHENTICATE(const MessageView& params, Client& client, Server& server) {
+        (void)params;
         if (client.isAuth()) {
             std::string error = ":ircserv 462 " + client.getNickname() + " :You may not reregister\r\n";
-            send(client.getSocketFd(), error.c_str(), error.length(), 0);
+            server.sendToClient(client, error);
             return;
         }
         if (client.hasSentPass() && client.hasSentNick() && client.hasSentUser()) {
             client.setAuth(true);
+            server.clientRegistered(client);
             std::string msg = client.getNickname() + ", You have been successfully authenticated!\r\n";
-            send(client.getSocketFd(), msg.c_str(), msg.length(), 0);
+            server.sendToClient(client, msg);
         } else {
             std::string error = ":ircserv 451 * :You have not registered\r\n";
-            send(client.getSocketFd(), error.c_str(), error.length(), 0);
+            server.sendToClient(client, error);
         }
 }
 
-void Command::PASS(const std::vector<std::string>& params, Client& client, Server& server) {
-    if (params.size() != 1)
-    {
-        std::string error = ":ircserv 461 * PASS :Not enough parameters\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
-        return;
-    }
+void Command::PASS(const MessageView& params, Client& client, Server& server) {
     
     if (client.isReg()) {
         std::string error = ":ircserv 462 * :You may not reregister\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
     
     if (client.hasSentNick() || client.hasSentUser()) {
         std::string error = ":ircserv 462 * :PASS must be sent before NICK and USER\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
@@ -115,54 +166,47 @@ void Command::PASS(const std::vector<std::string>& params, Client& client, Serve
         client.setReg(true);
         client.HasSentPass(true);
         std::string msg = "Welcome to the server! You must authenticate to join channels.\r\n";
-        send(client.getSocketFd(), msg.c_str(), msg.length(), 0);
+        server.sendToClient(client, msg);
     } else {
         std::string error = ":ircserv 464 * :Password incorrect\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
     }
 }
 
-void Command::NICK(const std::vector<std::string>& params, Client& client, Server& server) {
+void Command::NICK(const MessageView& params, Client& client, Server& server) {
     if (params.size() != 1)
     {
         std::string error = ":ircserv 431 * :No nickname given\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
     if (!client.hasSentPass()) {
         std::string error = ":ircserv 451 * :You must send PASS first\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
-    std::string nickname = params[0];
+    std::string nickname = params[0].str();
 
     if (nickname.empty()) {
         std::string error = ":ircserv 431 * :No nickname given\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
     if (!isValidNickname(nickname)) {
         std::string error = ":ircserv 432 * " + nickname + " :Erroneous nickname\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
-    if (server.manageNickname(nickname, NULL, CHECK)) {
+    // Taken means held by another client under RFC 1459 casemapping; a case change of our own nick is allowed
+    if (!server.manageNickname(nickname, &client, RENAME)) {
         std::string error = ":ircserv 433 * " + nickname + " :Nickname is already in use\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
-
-    std::string oldNickname = client.getNickname();
-    if (!oldNickname.empty()) {
-        server.manageNickname(oldNickname, NULL, UNREGISTER);
-    }
-
-    server.manageNickname(nickname, &client, REGISTER);
-    client.setNickname(nickname);
     client.HasSentNick(true);
 }
 
@@ -182,51 +226,32 @@ bool Command::isValidNickname(const std::string& nickname) {
     return true;
 }
 
-void Command::USER(const std::vector<std::string>& params, Client& client, Server& server) {
-    (void)server;
-    if (params.size() != 4)
-    {
-        std::string error = ":ircserv 461 * USER :Not enough parameters\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
-        return;
-    }
+void Command::USER(const MessageView& params, Client& client, Server& server) {
 
     if (!client.hasSentPass()) {
         std::string error = ":ircserv 451 * :You must send PASS first\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
     if (!client.hasSentNick()) {
         std::string error = ":ircserv 451 * :You must send NICK before USER\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
-    client.setUsername(params[0]);
-    client.setRealname(params[3]);
+    client.setUserInfo(params[0], params[3]);
     client.HasSentUser(true);
 }
 
 
-void Command::JOIN(const std::vector<std::string>& params, Client& client, Server& server) {
-    if (params.size() < 1 || params.size() > 2)
-    {
-        std::string error1 = ":ircserv 461 " + client.getNickname() + " JOIN :Not enough parameters\r\n";
-        send(client.getSocketFd(), error1.c_str(), error1.length(), 0);
-        return;
-    }
-    if (!client.isAuth()) {
-        std::string error2 = ":ircserv 451 " + client.getNickname() + " :You have not registered\r\n";
-        send(client.getSocketFd(), error2.c_str(), error2.length(), 0);
-        return;
-    }
+void Command::JOIN(const MessageView& params, Client& client, Server& server) {
 
-    const std::string channelName = params[0];
-    const std::string channelKey = (params.size() >= 2) ? params[1] : "";
-    if (channelName.empty() || channelName[0] != '#') {
+    const std::string channelName = params[0].str();
+    const std::string channelKey = (params.size() >= 2) ? params[1].str() : "";
+    if (channelName.empty() || channelName[0] != '#' || channelName.length() > Channel::NAME_MAX_LENGTH) {
         std::string error3 = ":ircserv 403 " + client.getNickname() + " " + channelName + " :No such channel\r\n";
-        send(client.getSocketFd(), error3.c_str(), error3.length(), 0);
+        server.sendToClient(client, error3);
         return;
     }
 
@@ -235,14 +260,14 @@ void Command::JOIN(const std::vector<std::string>& params, Client& client, Serve
 
     if (channel->isInviteOnly() && !channel->isInvited(&client)) {
         std::string error4 = ":ircserv 473 " + client.getNickname() + " " + channelName + " :Cannot join channel (+i)\r\n";
-        send(client.getSocketFd(), error4.c_str(), error4.length(), 0);
+        server.sendToClient(client, error4);
         return;
     }
 
-    if (channel->hasMode('k')) {
+    if (channel->hasKey()) {
         if (channelKey.empty() || channelKey != channel->getKey()) {
             std::string error5 = ":ircserv 475 " + client.getNickname() + " " + channelName + " :Cannot join channel (+k)\r\n";
-            send(client.getSocketFd(), error5.c_str(), error5.length(), 0);
+            server.sendToClient(client, error5);
             return;
         }
     }
@@ -250,70 +275,162 @@ void Command::JOIN(const std::vector<std::string>& params, Client& client, Serve
     if (channel->hasClientLimit()) {
         if (channel->isFull()) {
             std::string error6 = ":ircserv 471 " + client.getNickname() + " " + channelName + " :Cannot join channel (+l)\r\n";
-            send(client.getSocketFd(), error6.c_str(), error6.length(), 0);
+            server.sendToClient(client, error6);
             return;
         }
     }
 
-    if (!channel->hasClient(client.getNickname())){
+    if (!channel->hasClient(&client)){
         channel->addClient(&client);
 
-        if (channel->getClients().size() == 1) {
-            channel->setOperator(client.getNickname());
+        if (channel->getMemberCount() == 1) {
+            channel->setOperator(&client);
             // If creating channel with a password, set it and enable +k mode
-            if (!channelKey.empty()) {
+            if (!channelKey.empty())
                 channel->setKey(channelKey);
-                channel->addMode('k');
-            }
         }
         
         // Remove invitation only after successful join
         channel->removeInvitation(&client);
     }
 
-    std::string joinMsg = ":" + client.getNickname() + " JOIN " + channelName + "\r\n";
-    for (std::set<Client*>::iterator it = channel->getClients().begin(); it != channel->getClients().end(); ++it){
-        send((*it)->getSocketFd(), joinMsg.c_str(), joinMsg.length(), 0);
-    }
+    // Channel names are case-insensitive: replies spell the channel as its creator did
+    Reply joinMsg(server.getReplyArena());
+    joinMsg << client.getPrefix() << " JOIN " << channel->getName() << "\r\n";
+    server.broadcast(*channel, joinMsg.message());
 
     // Send topic to joining user (RPL_TOPIC = 332, RPL_NOTOPIC = 331)
-    if (!channel->getTopic().empty()) {
-        std::string topicMsg = ":ircserv 332 " + client.getNickname() + " " + channelName + " :" + channel->getTopic() + "\r\n";
-        send(client.getSocketFd(), topicMsg.c_str(), topicMsg.length(), 0);
-    } else {
-        std::string noTopicMsg = ":ircserv 331 " + client.getNickname() + " " + channelName + " :No topic is set\r\n";
-        send(client.getSocketFd(), noTopicMsg.c_str(), noTopicMsg.length(), 0);
+    Reply topicMsg(server.getReplyArena());
+    if (!channel->getTopic().empty())
+        topicMsg << ":ircserv 332 " << client.getNickname() << ' ' << channel->getName() << " :" << channel->getTopic() << "\r\n";
+    else
+        topicMsg << ":ircserv 331 " << client.getNickname() << ' ' << channel->getName() << " :No topic is set\r\n";
+    server.sendToClient(client, topicMsg.message());
+
+    sendNames(channel, channel->getName(), client, server);
+}
+
+// RPL_NAMREPLY (353) lines from the channel's cached chunks, then RPL_ENDOFNAMES (366), in one send
+void Command::sendNames(const Channel* channel, const std::string& channelName, Client& client, Server& server) {
+    std::string reply;
+    if (channel) {
+        const std::vector<std::string>& chunks = channel->getNamesChunks();
+        for (size_t i = 0; i < chunks.size(); ++i)
+            reply += ":ircserv 353 " + client.getNickname() + " = " + channel->getName() + " :" + chunks[i] + "\r\n";
+    }
+    // Like the 353 lines, the channel's own spelling; a channel that does not exist only has the typed one
+    reply += ":ircserv 366 " + client.getNickname() + " " + (channel ? channel->getName() : channelName) + " :End of /NAMES list\r\n";
+    server.sendToClient(client, reply);
+}
+
+void Command::NAMES(const MessageView& params, Client& client, Server& server) {
+    if (params.size() == 0) {
+        std::string reply = ":ircserv 366 " + client.getNickname() + " * :End of /NAMES list\r\n";
+        server.sendToClient(client, reply);
+        return;
     }
 
-    std::string namesList = client.getNickname() + "=" + channelName + " :";
-    for (std::set<Client*>::iterator it = channel->getClients().begin(); it != channel->getClients().end(); ++it) {
-        if (channel->isOperator(*it)) {
-            namesList += "@" + (*it)->getNickname() + " ";
-        } else {
-            namesList += (*it)->getNickname() + " ";
-        }
+    // NAMES #a,#b answers each channel in turn; unknown channels only get the 366
+    std::string list = params[0].str();
+    size_t start = 0;
+    while (start <= list.length()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos)
+            comma = list.length();
+        std::string channelName = list.substr(start, comma - start);
+        if (!channelName.empty())
+            sendNames(server.getChannel(channelName), channelName, client, server);
+        start = comma + 1;
     }
-    namesList += "\r\n";
-    send(client.getSocketFd(), namesList.c_str(), namesList.length(), 0);
 }
 
-void Command::KICK(const std::vector<std::string>& params, Client& client, Server& server) {
-    if (params.size() < 2)
-    {
-        std::string error = ":ircserv 461 " + client.getNickname() + " KICK :Not enough parameters\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+void Command::PING(const MessageView& params, Client& client, Server& server) {
+    if (params.size() == 0) {
+        std::string nick = client.getNickname().empty() ? "*" : client.getNickname();
+        server.sendToClient(client, ":ircserv 409 " + nick + " :No origin specified\r\n");
         return;
     }
-    std::string channelName = params[0];
-    std::string targetNickname = params[1];
+    server.sendToClient(client, ":ircserv PONG ircserv :" + params[0].str() + "\r\n");
+}
+
+void Command::PONG(const MessageView& params, Client& client, Server& server) {
+    // The reactor already counted the line as activity, which is all a keepalive PONG proves
+    (void)params;
+    (void)client;
+    (void)server;
+}
+
+// "p50 <n> p99 <n> max <n>", percentiles rounded up to the bucket bound (a power of two minus one)
+static std::string summarize(const Histogram& histogram) {
+    std::ostringstream out;
+    out << "p50 " << histogram.percentile(500) << " p99 " << histogram.percentile(990)
+        << " p999 " << histogram.percentile(999) << " max " << histogram.max;
+    return out.str();
+}
+
+// "<name>: <n> in use, peak <n>, <n> slots of <n> bytes in <n> slabs, <n> allocations, <n> frees"
+static std::string describe(const PoolStats& pool) {
+    std::ostringstream out;
+    out << pool.name << ": " << pool.inUse << " in use, peak " << pool.peakInUse << ", " << pool.capacity << " slots of "
+        << pool.objectSize << " bytes in " << pool.slabs << " slabs, " << pool.allocations << " allocations, " << pool.frees << " frees";
+    return out.str();
+}
+
+// STATS m lists RPL_STATSCOMMANDS for every command used; STATS t reports traffic,
+// event loop and handler latency figures and STATS z the allocators, as RPL_STATSDEBUG lines
+void Command::STATS(const MessageView& params, Client& client, Server& server) {
+    const std::string& nick = client.getNickname();
+    std::string query = params[0].str();
+    const CoreMetrics& metrics = server.getMetrics();
+    const size_t count = sizeof(_commands) / sizeof(_commands[0]);
+    std::ostringstream out;
+
+    if (query == "m") {
+        for (size_t i = 0; i < count; ++i) {
+            const CommandMetrics& stats = metrics.commands[i];
+            if (stats.calls > 0)
+                out << ":ircserv 212 " << nick << " " << _commands[i].name << " " << stats.calls << " " << stats.bytes << " 0\r\n";
+        }
+    } else if (query == "t") {
+        LoopMetrics loop = server.getLoopMetrics();
+        const std::string prefix = ":ircserv 249 " + nick + " :";
+        out << prefix << "traffic " << loop.bytesIn << " bytes in, " << loop.bytesOut << " bytes out\r\n"
+            << prefix << "loop " << loop.iterationNs.count << " wakeups, busy ns " << summarize(loop.iterationNs) << "\r\n"
+            << prefix << "ready fds per wakeup " << summarize(loop.readyFds) << "\r\n"
+            << prefix << "broadcasts " << metrics.fanout.count << ", recipients " << summarize(metrics.fanout) << "\r\n"
+            << prefix << "unknown commands " << metrics.unknownCommands << "\r\n"
+            << prefix << "log records " << Log::getWritten() << " written, " << Log::getDropped() << " dropped, "
+            << Log::getSampledOut() << " sampled out\r\n";
+        for (size_t i = 0; i < count; ++i) {
+            const CommandMetrics& stats = metrics.commands[i];
+            if (stats.handlerNs.count > 0)
+                out << prefix << _commands[i].name << " handler ns " << summarize(stats.handlerNs) << "\r\n";
+        }
+    } else if (query == "z") {
+        const std::string prefix = ":ircserv 249 " + nick + " :";
+        std::vector<PoolStats> pools = MessageBuffer::getPoolStats();
+        pools.insert(pools.begin(), Channel::getPoolStats());
+        pools.insert(pools.begin(), Client::getPoolStats());
+        for (size_t i = 0; i < pools.size(); ++i)
+            out << prefix << "pool " << describe(pools[i]) << "\r\n";
+        ArenaStats arena = server.getReplyArena().getStats();
+        out << prefix << "messages too large for a pool " << MessageBuffer::getHeapPayloads() << "\r\n"
+            << prefix << "reply arena: " << arena.bytesReserved << " bytes in " << arena.chunks << " chunks, peak "
+            << arena.peakBytes << " bytes per iteration, " << arena.allocations << " allocations, " << arena.resets << " resets, "
+            << arena.overflowChunks << " overflow chunks\r\n";
+    }
+    out << ":ircserv 219 " << nick << " " << query << " :End of STATS report\r\n";
+    server.sendToClient(client, out.str());
+}
+
+void Command::KICK(const MessageView& params, Client& client, Server& server) {
+    std::string channelName = params[0].str();
+    std::string targetNickname = params[1].str();
     
     // Combine all remaining parameters as the kick message
     std::string comment;
     if (params.size() >= 3) {
-        comment = params[2];
-        for (size_t i = 3; i < params.size(); ++i) {
-            comment += " " + params[i];
-        }
+        comment = params.join(2);
         // Remove leading ':' if present
         if (!comment.empty() && comment[0] == ':')
             comment = comment.substr(1);
@@ -324,408 +441,345 @@ void Command::KICK(const std::vector<std::string>& params, Client& client, Serve
     Channel* channel = server.getChannel(channelName);
     if (!channel) {
         std::string error = ":ircserv 403 " + client.getNickname() + " " + channelName + " :No such channel\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
 
     }
-    if (!channel->isOperator(client.getNickname())) {
+    if (!channel->isOperator(&client)) {
         std::string error = ":ircserv 482 " + client.getNickname() + " " + channelName + " :You're not channel operator\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
     
+    Client* targetClient = server.getClientByNickname(targetNickname);
+
     // Operator cannot kick themselves
-    if (targetNickname == client.getNickname()) {
+    if (targetClient == &client) {
         std::string error = ":ircserv 484 " + client.getNickname() + " " + channelName + " :You cannot kick yourself\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
-    
-    Client* targetClient = server.getClientByNickname(targetNickname);
 
-    if (!targetClient || !channel->hasClient(targetNickname)) {
+    if (!targetClient || !targetClient->isInChannel(channel)) {
         std::string error = ":ircserv 441 " + client.getNickname() + " " + targetNickname + " " + channelName + " :They aren't on that channel\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
+    targetNickname = targetClient->getNickname(); // Lookup is case-insensitive, echo the nick as registered
 
-    std::string kickMsg = ":" + client.getNickname() + " KICK " + channelName + " " + targetNickname + " :" + comment + "\r\n";
+    std::string kickMsg = client.getPrefix() + " KICK " + channelName + " " + targetNickname + " :" + comment + "\r\n";
     
     // Send kick message to all clients in channel (including the one being kicked)
-    for (std::set<Client*>::iterator it = channel->getClients().begin(); it != channel->getClients().end(); ++it) {
-        send((*it)->getSocketFd(), kickMsg.c_str(), kickMsg.length(), 0);
-    }
+    server.broadcast(*channel, kickMsg);
     
     // Now remove the client from the channel
-    channel->removeClient(targetNickname);
+    channel->removeClient(targetClient);
 }
 
 
-void Command::INVITE(const std::vector<std::string>& params, Client& client, Server& server) {
-    if (params.size() != 2)
-    {
-        std::string error = ":ircserv 461 " + client.getNickname() + " INVITE :Not enough parameters\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
-        return;
-    }
-    std::string targetNickname = params[0];
-    std::string channelName = params[1];
+void Command::INVITE(const MessageView& params, Client& client, Server& server) {
+    std::string targetNickname = params[0].str();
+    std::string channelName = params[1].str();
 
     Channel* channel = server.getChannel(channelName);
     if (!channel) {
         std::string error = ":ircserv 403 " + client.getNickname() + " " + channelName + " :No such channel\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
-    if (!channel->isOperator(client.getNickname())) {
+    if (!channel->isOperator(&client)) {
         std::string error = ":ircserv 482 " + client.getNickname() + " " + channelName + " :You're not channel operator\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
     Client* targetClient = server.getClientByNickname(targetNickname);
     if (!targetClient) {
         std::string error = ":ircserv 401 " + client.getNickname() + " " + targetNickname + " :No such nick/channel\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
+    targetNickname = targetClient->getNickname();
 
-    if (channel->hasClient(targetNickname)) {
+    if (channel->hasClient(targetClient)) {
         std::string error = ":ircserv 443 " + client.getNickname() + " " + targetNickname + " " + channelName + " :is already on channel\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
     if (channel->isInvited(targetClient)) {
         std::string error = ":ircserv 443 " + client.getNickname() + " " + targetNickname + " " + channelName + " :is already invited\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
     channel->addInvitation(targetClient);
 
-    std::string inviteMsg = ":" + client.getNickname() + " INVITE " + targetNickname + " :" + channelName + "\r\n";
-    send(targetClient->getSocketFd(), inviteMsg.c_str(), inviteMsg.length(), 0);
+    std::string inviteMsg = client.getPrefix() + " INVITE " + targetNickname + " :" + channelName + "\r\n";
+    server.sendToClient(*targetClient, inviteMsg);
 }
 
-void Command::TOPIC(const std::vector<std::string>& params, Client& client, Server& server) {
-    if (params.size() < 1)
-    {
-        std::string error = ":ircserv 461 " + client.getNickname() + " TOPIC :Not enough parameters\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
-        return;
-    }
+void Command::TOPIC(const MessageView& params, Client& client, Server& server) {
 
-    std::string channelName = params[0];
+    std::string channelName = params[0].str();
 
     Channel* channel = server.getChannel(channelName);
     if (!channel) {
         std::string error = ":ircserv 403 " + client.getNickname() + " " + channelName + " :No such channel\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
-    if (!channel->hasClient(client.getNickname())) {
+    if (!channel->hasClient(&client)) {
         std::string error = ":ircserv 442 " + client.getNickname() + " " + channelName + " :You're not on that channel\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
     // SET TOPIC
     if (params.size() >= 2) {
-        if (channel->hasMode('t') && !channel->isOperator(&client)) {
+        if (channel->hasMode(CMODE_TOPIC_LOCK) && !channel->isOperator(&client)) {
             std::string error = ":ircserv 482 " + channelName + " :You're not a channel operator\r\n";
-            send(client.getSocketFd(), error.c_str(), error.length(), 0);
+            server.sendToClient(client, error);
             return;
         }
 
         // Combine topic text
-        std::string newTopic = params[1];
-        for (size_t i = 2; i < params.size(); ++i) {
-            newTopic += " " + params[i];
-        }
+        std::string newTopic = params.join(1);
         // Remove leading ':' if present
         if (!newTopic.empty() && newTopic[0] == ':')
             newTopic = newTopic.substr(1);
 
         channel->setTopic(newTopic);
 
-        std::string topicMsg = ":" + client.getNickname() + " TOPIC " + channelName + " :" + newTopic + "\r\n";
-        for (std::set<Client*>::iterator it = channel->getClients().begin(); it != channel->getClients().end(); ++it) {
-            send((*it)->getSocketFd(), topicMsg.c_str(), topicMsg.length(), 0);
-        }
+        std::string topicMsg = client.getPrefix() + " TOPIC " + channelName + " :" + newTopic + "\r\n";
+        server.broadcast(*channel, topicMsg);
     }
     // VIEW TOPIC
     else {
         if (!channel->getTopic().empty()) {
             std::string topic = ":ircserv 332 " + client.getNickname() + " " + channelName + " :" + channel->getTopic() + "\r\n";
-            send(client.getSocketFd(), topic.c_str(), topic.length(), 0);
+            server.sendToClient(client, topic);
         } else {
             std::string notopic = ":ircserv 331 " + client.getNickname() + " " + channelName + " :No topic is set\r\n";
-            send(client.getSocketFd(), notopic.c_str(), notopic.length(), 0);
+            server.sendToClient(client, notopic);
         }
     }
 }
 
-void Command::MODE(const std::vector<std::string>& params, Client& client, Server& server) {
-    if (params.size() < 1)
-    {
-        std::string error = ":ircserv 461 " + client.getNickname() + " MODE :Not enough parameters\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
-        return;
-    }
+void Command::MODE(const MessageView& params, Client& client, Server& server) {
 
-    std::string channelName = params[0];
+    std::string channelName = params[0].str();
 
     Channel* channel = server.getChannel(channelName);
 
     if (!channel) {
         std::string error = ":ircserv 403 " + client.getNickname() + " " + channelName + " :No such channel\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
     // If only channel name provided, display current modes (RPL_CHANNELMODEIS = 324)
     if (params.size() == 1) {
-        std::string modes = channel->getModes();
-        std::string modeStr = "+";
-        if (!modes.empty()) {
-            modeStr += modes;
-        }
-        std::string response = ":ircserv 324 " + client.getNickname() + " " + channelName + " " + modeStr + "\r\n";
-        send(client.getSocketFd(), response.c_str(), response.length(), 0);
+        std::string response = ":ircserv 324 " + client.getNickname() + " " + channelName + " " + channel->getModeString() + "\r\n";
+        server.sendToClient(client, response);
         return;
     }
 
-    std::string modeChanges = params[1];
+    std::string modeChanges = params[1].str();
 
-    if (!channel->isOperator(client.getNickname())) {
+    if (!channel->isOperator(&client)) {
         std::string error = ":ircserv 482 " + client.getNickname() + " " + channelName + " :You're not channel operator\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
     
     char sign = modeChanges[0];
     if (sign != '+' && sign != '-') {
         std::string error = ":ircserv 472 " + modeChanges + " :is unknown mode char\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        server.sendToClient(client, error);
         return;
     }
 
     size_t argIndex = 2;
 
-    std::string modesConfirmed = ":" + client.getNickname() + " MODE " + channelName + " " + modeChanges;
+    std::string modesConfirmed = client.getPrefix() + " MODE " + channelName + " " + modeChanges;
 
     for (size_t i = 1; i < modeChanges.length(); ++i) {
         char mode = modeChanges[i];
+        const ModeDescriptor* desc = Channel::findMode(mode);
+        if (!desc) {
+            std::string error = ":ircserv 472 ";
+            error += mode;
+            error += " :is unknown mode char\r\n";
+            server.sendToClient(client, error);
+            return;
+        }
 
-        switch (mode) {
-            case 'i':
-                if (sign == '+')
-                    channel->addMode('i');
-                else
-                    channel->removeMode('i');
-                break;
+        std::string arg;
+        if (sign == '+' ? desc->paramOnSet : desc->paramOnUnset) {
+            if (params.size() <= argIndex) {
+                std::string error = ":ircserv 461 MODE :" + std::string(desc->missingParam) + "\r\n";
+                server.sendToClient(client, error);
+                return;
+            }
+            arg = params[argIndex++].str();
+        }
 
-            case 't':
-                if (sign == '+') {
-                    channel->addMode('t');
-                    // If topic parameter is provided with +t, set the topic
-                    if (params.size() > argIndex) {
-                        std::string topic = params[argIndex];
-                        // Combine remaining parameters as topic (in case of multi-word topic)
-                        for (size_t j = argIndex + 1; j < params.size(); ++j) {
-                            topic += " " + params[j];
+        switch (desc->kind) {
+            case ModeDescriptor::CHANNEL_FLAG:
+                channel->setMode(static_cast<ChannelMode>(desc->bit), sign == '+');
+                if (desc->bit == CMODE_TOPIC_LOCK) {
+                    if (sign == '+') {
+                        // If topic parameter is provided with +t, set the topic
+                        if (params.size() > argIndex) {
+                            // Combine remaining parameters as topic (in case of multi-word topic)
+                            std::string topic = params.join(argIndex);
+                            // Remove leading ':' if present
+                            if (!topic.empty() && topic[0] == ':')
+                                topic = topic.substr(1);
+                            channel->setTopic(topic);
+                            argIndex = params.size(); // Consume all remaining params
                         }
-                        // Remove leading ':' if present
-                        if (!topic.empty() && topic[0] == ':')
-                            topic = topic.substr(1);
-                        channel->setTopic(topic);
-                        argIndex = params.size(); // Consume all remaining params
+                    } else {
+                        // MODE -t deletes the topic
+                        channel->setTopic("");
                     }
-                } else {
-                    channel->removeMode('t');
-                    // MODE -t deletes the topic
-                    channel->setTopic("");
                 }
                 break;
 
-            case 'k':
-                if (sign == '+') {
-                    if (params.size() <= argIndex) {
-                        std::string error = ":ircserv 461 MODE :Missing key parameter for +k\r\n";
-                        send(client.getSocketFd(), error.c_str(), error.length(), 0);
-                        return;
-                    }
-                    channel->setKey(params[argIndex++]);
-                    channel->addMode('k');
-                } else {
+            case ModeDescriptor::CHANNEL_KEY:
+                if (sign == '+')
+                    channel->setKey(arg);
+                else
                     channel->removeKey();
-                    channel->removeMode('k');
-                }
                 break;
 
-            case 'l':
+            case ModeDescriptor::CHANNEL_LIMIT:
                 if (sign == '+') {
-                    if (params.size() <= argIndex) {
-                        std::string error = ":ircserv 461 MODE :Missing parameter for +l\r\n";
-                        send(client.getSocketFd(), error.c_str(), error.length(), 0);
-                        return;
-                    }
-
                     size_t limit = 0;
-                    for (size_t j = 0; j < params[argIndex].length(); ++j) {
-                        if (params[argIndex][j] >= '0' && params[argIndex][j] <= '9') {
-                            limit = limit * 10 + (params[argIndex][j] - '0');
+                    for (size_t j = 0; j < arg.length(); ++j) {
+                        if (arg[j] >= '0' && arg[j] <= '9') {
+                            limit = limit * 10 + (arg[j] - '0');
                         } else {
                             std::string error = ":ircserv 461 MODE :Invalid limit value\r\n";
-                            send(client.getSocketFd(), error.c_str(), error.length(), 0);
+                            server.sendToClient(client, error);
                             return;
                         }
                     }
-                    argIndex++;
-
                     channel->setClientLimit(limit);
                 } else {
                     channel->removeClientLimit();
                 }
                 break;
 
-            case 'o':
-                if (params.size() <= argIndex) {
-                    std::string error = ":ircserv 461 MODE :Missing nickname parameter for +o/-o\r\n";
-                    send(client.getSocketFd(), error.c_str(), error.length(), 0);
-                    return;
-                }
-
+            case ModeDescriptor::MEMBER_STATUS:
                 {
-                    std::string targetNick = params[argIndex++];
-                    Client* target = server.getClientByNickname(targetNick);
+                    Client* target = server.getClientByNickname(arg);
 
-                    if (!target || !channel->hasClient(targetNick)) {
-                        std::string error = ":ircserv 441 " + targetNick + " " + channelName + " :They aren't on that channel\r\n";
-                        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+                    if (!target || !channel->hasClient(target)) {
+                        std::string error = ":ircserv 441 " + arg + " " + channelName + " :They aren't on that channel\r\n";
+                        server.sendToClient(client, error);
                         return;
                     }
+                    std::string targetNick = target->getNickname();
 
-                   // Operat or cannot remove their own operator status with -o
-                    if (sign == '-' && targetNick == client.getNickname()) {
+                    // Operator cannot remove their own operator status with -o
+                    if (sign == '-' && target == &client) {
                         std::string error = ":ircserv 484 " + client.getNickname() + " " + channelName + " :You cannot remove your own operator status\r\n";
-                        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+                        server.sendToClient(client, error);
                         return;
                     }
 
                     if (sign == '+')
-                        channel->setOperator(targetNick);
+                        channel->setOperator(target);
                     else
                         channel->removeOperator(target);
 
-                    // Inform everyone about the operator change
-                    std::string opChange = ":" + client.getNickname() + " MODE " + channelName + " " + sign + "o " + targetNick + "\r\n";
-                    for (std::set<Client*>::iterator it = channel->getClients().begin(); it != channel->getClients().end(); ++it)
-                        send((*it)->getSocketFd(), opChange.c_str(), opChange.length(), 0);
+                    // Inform everyone about the status change
+                    std::string statusChange = client.getPrefix() + " MODE " + channelName + " " + sign + desc->letter + " " + targetNick + "\r\n";
+                    server.broadcast(*channel, statusChange);
                 }
                 break;
-
-            default:
-                std::string error = ":ircserv 472 ";
-                error += mode;
-                error += " :is unknown mode char\r\n";
-                send(client.getSocketFd(), error.c_str(), error.length(), 0);
-                return;
         }
     }
 
     modesConfirmed += "\r\n";
 
     // Broadcast the overall mode change to all users in the channel
-    for (std::set<Client*>::iterator it = channel->getClients().begin(); it != channel->getClients().end(); ++it) {
-        send((*it)->getSocketFd(), modesConfirmed.c_str(), modesConfirmed.length(), 0);
-    }
+    server.broadcast(*channel, modesConfirmed);
 }
 
-void Command::PRIVMSG(const std::vector<std::string>& params, Client& client, Server& server) {
+void Command::PRIVMSG(const MessageView& params, Client& client, Server& server) {
+    Reply reply(server.getReplyArena());
     if (params.size() < 1)
     {
-        std::string error = ":ircserv 411 " + client.getNickname() + " :No recipient given (PRIVMSG)\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        reply << ":ircserv 411 " << client.getNickname() << " :No recipient given (PRIVMSG)\r\n";
+        server.sendToClient(client, reply.message());
         return;
     }
     
     if (params.size() < 2)
     {
-        std::string error = ":ircserv 412 " + client.getNickname() + " :No text to send\r\n";
-        send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        reply << ":ircserv 412 " << client.getNickname() << " :No text to send\r\n";
+        server.sendToClient(client, reply.message());
         return;
     }
 
-    std::string target = params[0];
-    std::string message = params[1];
-    for (size_t i = 2; i < params.size(); ++i) {
-            message += " " + params[i];
-    }
+    std::string target = params[0].str();
 
     if (target[0] == '#') {
         Channel* channel = server.getChannel(target);
         if (!channel) {
-            std::string error = ":ircserv 403 " + client.getNickname() + " " + target + " :No such channel\r\n";
-            send(client.getSocketFd(), error.c_str(), error.length(), 0);
+            reply << ":ircserv 403 " << client.getNickname() << ' ' << target << " :No such channel\r\n";
+            server.sendToClient(client, reply.message());
             return;
         }
-        if (!channel->hasClient(client.getNickname())) {
-            std::string error = ":ircserv 404 " + client.getNickname() + " " + target + " :Cannot send to channel\r\n";
-            send(client.getSocketFd(), error.c_str(), error.length(), 0);
+        if (!channel->hasClient(&client)) {
+            reply << ":ircserv 404 " << client.getNickname() << ' ' << target << " :Cannot send to channel\r\n";
+            server.sendToClient(client, reply.message());
             return;
         }
 
-        std::string privMsg = ":" + client.getNickname() + " PRIVMSG " + target + " :" + message + "\r\n";
-        for (std::set<Client*>::iterator it = channel->getClients().begin(); it != channel->getClients().end(); ++it) {
-            if ((*it)->getNickname() != client.getNickname()) {
-                send((*it)->getSocketFd(), privMsg.c_str(), privMsg.length(), 0);
-            }
-        }
+        reply << client.getPrefix() << " PRIVMSG " << target << " :";
+        reply.appendJoined(params, 1) << "\r\n";
+        server.broadcast(*channel, reply.message(), &client);
     } else {
         Client* targetClient = server.getClientByNickname(target);
         if (!targetClient) {
-            std::string error = ":ircserv 401 " + client.getNickname() + " " + target + " :No such nick/channel\r\n";
-            send(client.getSocketFd(), error.c_str(), error.length(), 0);
+            reply << ":ircserv 401 " << client.getNickname() << ' ' << target << " :No such nick/channel\r\n";
+            server.sendToClient(client, reply.message());
             return;
         }
 
-        std::string privMsg = ":" + client.getNickname() + " PRIVMSG " + target + " :" + message + "\r\n";
-        send(targetClient->getSocketFd(), privMsg.c_str(), privMsg.length(), 0);
+        reply << client.getPrefix() << " PRIVMSG " << target << " :";
+        reply.appendJoined(params, 1) << "\r\n";
+        server.sendToClient(*targetClient, reply.message());
     }
 }
 
-void Command::NOTICE(const std::vector<std::string>& params, Client& client, Server& server) {
-    // NOTICE never sends error replies to avoid loops
-    if (params.size() < 2)
-        return;
-
-    std::string target = params[0];
-    std::string message = params[1];
-    for (size_t i = 2; i < params.size(); ++i) {
-        message += " " + params[i];
-    }
+void Command::NOTICE(const MessageView& params, Client& client, Server& server) {
+    // NOTICE never sends error replies to avoid loops (CMD_SILENT in the dispatch table)
+    std::string target = params[0].str();
 
     if (target[0] == '#') {
         Channel* channel = server.getChannel(target);
         if (!channel)
             return;
-        if (!channel->hasClient(client.getNickname()))
+        if (!channel->hasClient(&client))
             return;
 
-        std::string noticeMsg = ":" + client.getNickname() + " NOTICE " + target + " :" + message + "\r\n";
-        for (std::set<Client*>::iterator it = channel->getClients().begin(); it != channel->getClients().end(); ++it) {
-            if ((*it)->getNickname() != client.getNickname()) {
-                send((*it)->getSocketFd(), noticeMsg.c_str(), noticeMsg.length(), 0);
-            }
-        }
+        Reply noticeMsg(server.getReplyArena());
+        noticeMsg << client.getPrefix() << " NOTICE " << target << " :";
+        noticeMsg.appendJoined(params, 1) << "\r\n";
+        server.broadcast(*channel, noticeMsg.message(), &client);
     } else {
         Client* targetClient = server.getClientByNickname(target);
         if (!targetClient)
             return;
 
-        std::string noticeMsg = ":" + client.getNickname() + " NOTICE " + target + " :" + message + "\r\n";
-        send(targetClient->getSocketFd(), noticeMsg.c_str(), noticeMsg.length(), 0);
+        Reply noticeMsg(server.getReplyArena());
+        noticeMsg << client.getPrefix() << " NOTICE " << target << " :";
+        noticeMsg.appendJoined(params, 1) << "\r\n";
+        server.sendToClient(*targetClient, noticeMsg.message());
     }
 }
\ No newline at end of file
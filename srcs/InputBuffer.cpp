@@ -0,0 +1,122 @@
+#include "../includes/InputBuffer.hpp"
+#include <cstring>
+
+const size_t InputBuffer::CAPACITY;
+const size_t InputBuffer::MAX_LINE;
+
+InputBuffer::InputBuffer() : _data(NULL), _lent(false), _head(0), _tail(0), _scan(0), _discarding(false) {}
+
+InputBuffer::~InputBuffer()
+{
+    if (!_lent)
+        delete[] _data;
+}
+
+void InputBuffer::lend(char* scratch)
+{
+    if (!_data) {
+        _data = scratch;
+        _lent = true;
+    }
+}
+
+void InputBuffer::settle()
+{
+    if (!_data)
+        return;
+    if (empty()) { // _discarding survives: an overlong line is skipped across reads either way
+        if (!_lent)
+            delete[] _data;
+        _data = NULL;
+        _lent = false;
+        _head = _tail = _scan = 0;
+        return;
+    }
+    if (_lent) {
+        char* own = new char[CAPACITY];
+        memcpy(own, _data + _head, _tail - _head);
+        _data = own;
+        _lent = false;
+        _scan -= _head;
+        _tail -= _head;
+        _head = 0;
+        return;
+    }
+    compact();
+}
+
+char* InputBuffer::writePtr()
+{
+    if (!_data)
+        _data = new char[CAPACITY];
+    return _data + _tail;
+}
+
+size_t InputBuffer::writable()
+{
+    if (_tail == CAPACITY)
+        compact();
+    return CAPACITY - _tail;
+}
+
+void InputBuffer::commit(size_t bytes)
+{
+    _tail += bytes;
+}
+
+InputBuffer::LineStatus InputBuffer::nextLine(const char*& line, size_t& length)
+{
+    while (_scan < _tail) {
+        const char* start = _data + _head;
+        const char* newline = static_cast<const char*>(memchr(_data + _scan, '\n', _tail - _scan));
+
+        if (!newline) {
+            _scan = _tail;
+            if (_discarding) { // Still inside the overlong line: drop what arrived so far
+                _head = _scan = _tail;
+            } else if (_tail - _head >= MAX_LINE) { // No newline within the limit
+                _discarding = true;
+                _head = _scan = _tail;
+                return LINE_TOO_LONG;
+            }
+            return LINE_NONE;
+        }
+
+        size_t lineLength = newline - start;
+        _head = _scan = newline - _data + 1;
+
+        if (_discarding) { // End of an overlong line that was already reported
+            _discarding = false;
+            continue;
+        }
+        if (lineLength + 1 > MAX_LINE)
+            return LINE_TOO_LONG;
+
+        if (lineLength > 0 && start[lineLength - 1] == '\r')
+            --lineLength;
+        line = start;
+        length = lineLength;
+        return LINE_OK;
+    }
+    return LINE_NONE;
+}
+
+// Reclaims consumed space. The leftover is at most one partial line, or the lines a
+// throttled client is waiting to run, so the move is bounded by CAPACITY no matter how
+// many lines were drained before it.
+void InputBuffer::compact()
+{
+    if (_head == 0)
+        return;
+    size_t remaining = _tail - _head;
+    if (remaining > 0)
+        memmove(_data, _data + _head, remaining);
+    _scan -= _head;
+    _tail = remaining;
+    _head = 0;
+}
+
+bool InputBuffer::empty() const
+{
+    return _head == _tail;
+}
@@ -0,0 +1,376 @@
+#include "../includes/Log.hpp"
+#include <stdexcept>
+#include <cstring> // for memcpy
+#include <cerrno>
+#include <unistd.h> // for write()
+#include <sys/time.h> // for gettimeofday()
+#include <time.h> // for localtime_r(), nanosleep()
+
+static const size_t LINE_MAX_BYTES = 64 + LogRecord::TEXT; // Timestamp, level and category, text, newline
+static const size_t WRITE_BATCH = 64 * 1024; // Bytes the writer gathers per write()
+static const long MIN_NAP_NS = 100000L; // Writer's nap when the ring runs empty, doubled while it stays empty
+static const long MAX_NAP_NS = 64 * 1000000L;
+
+static const char* const LEVEL_NAMES[] = { "ERROR", "WARN", "INFO", "DEBUG", "TRACE" };
+static const char* const CATEGORY_NAMES[] = { "server", "conn", "command", "channel" };
+
+LogConfig::LogConfig() : level(LOG_INFO), ringRecords(4096)
+{
+    for (size_t i = 0; i < LOG_CATEGORIES; ++i)
+        sample[i] = 1;
+}
+
+LogConfig Log::_config;
+LogRecord* Log::_ring = NULL;
+unsigned long Log::_mask = 0;
+volatile unsigned long Log::_head = 0;
+volatile unsigned long Log::_sampleCounters[LOG_CATEGORIES];
+volatile unsigned long Log::_written = 0;
+volatile unsigned long Log::_dropped = 0;
+volatile unsigned long Log::_sampledOut = 0;
+volatile int Log::_stopping = 0;
+bool Log::_running = false;
+pthread_t Log::_writer;
+
+static size_t putNumber(char* out, unsigned long value, size_t width) // decimal, zero-padded to width
+{
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    while (count < width)
+        digits[count++] = '0';
+    for (size_t i = 0; i < count; ++i)
+        out[i] = digits[count - 1 - i];
+    return count;
+}
+
+static size_t putText(char* out, const char* text)
+{
+    size_t length = strlen(text);
+    memcpy(out, text, length);
+    return length;
+}
+
+void Log::start(const LogConfig& config)
+{
+    _config = config;
+    size_t capacity = 1;
+    while (capacity < config.ringRecords)
+        capacity <<= 1;
+    _ring = new LogRecord[capacity];
+    for (size_t i = 0; i < capacity; ++i)
+        _ring[i].sequence = i;
+    _mask = capacity - 1;
+    _head = 0;
+    _stopping = 0;
+
+    if (pthread_create(&_writer, NULL, &Log::writerMain, NULL) != 0) {
+        delete[] _ring;
+        _ring = NULL;
+        throw std::runtime_error("Failed to start log writer thread");
+    }
+    _running = true;
+}
+
+void Log::stop()
+{
+    if (!_running)
+        return;
+    _stopping = 1;
+    pthread_join(_writer, NULL);
+    _running = false; // From here on, records are written synchronously
+    delete[] _ring;
+    _ring = NULL;
+
+    if ((_dropped > 0 || _sampledOut > 0) && shouldLog(LOG_INFO, LOG_SERVER))
+        LogLine(LOG_INFO, LOG_SERVER) << "Log stats: " << _written << " records written, " << _dropped
+                                      << " dropped (ring full), " << _sampledOut << " sampled out";
+}
+
+bool Log::shouldLog(LogLevel level, LogCategory category)
+{
+    if (level > _config.level)
+        return false;
+    unsigned int every = _config.sample[category];
+    if (level <= LOG_WARN || every <= 1)
+        return true;
+    if (__sync_fetch_and_add(&_sampleCounters[category], 1) % every == 0)
+        return true;
+    __sync_fetch_and_add(&_sampledOut, 1);
+    return false;
+}
+
+// Claims the next slot with a compare-and-swap on the head, fills it, then publishes it by
+// advancing its sequence number. Nothing here waits for the writer.
+void Log::write(LogLevel level, LogCategory category, const char* text, size_t length)
+{
+    if (length > LogRecord::TEXT)
+        length = LogRecord::TEXT;
+    timeval now;
+    gettimeofday(&now, NULL);
+
+    LogRecord local;
+    LogRecord* record = &local;
+    unsigned long pos = 0;
+    if (_running) {
+        pos = _head;
+        while (true) {
+            record = &_ring[pos & _mask];
+            long diff = static_cast<long>(record->sequence - pos);
+            if (diff == 0) { // Free for this position: try to claim it
+                unsigned long seen = __sync_val_compare_and_swap(&_head, pos, pos + 1);
+                if (seen == pos)
+                    break;
+                pos = seen;
+            } else if (diff < 0) { // Still holds a record from the previous lap: the ring is full
+                __sync_fetch_and_add(&_dropped, 1);
+                return;
+            } else { // Another producer claimed it first
+                pos = _head;
+            }
+        }
+    }
+
+    record->timeMs = now.tv_sec * 1000UL + now.tv_usec / 1000;
+    record->level = level;
+    record->category = category;
+    record->length = length;
+    memcpy(record->text, text, length);
+
+    if (!_running) { // Before start() or after stop(): no writer thread to hand it to
+        char line[LINE_MAX_BYTES];
+        writeAll(line, format(*record, line));
+        return;
+    }
+    __sync_synchronize(); // The contents must be visible before the slot is
+    record->sequence = pos + 1;
+}
+
+void* Log::writerMain(void* arg)
+{
+    (void)arg;
+    char out[WRITE_BATCH];
+    unsigned long tail = 0; // Next position to write out: kept off the producers' cache lines
+    unsigned long reportedDrops = 0;
+    long napNs = MIN_NAP_NS;
+
+    while (true) {
+        bool stopping = _stopping; // Read first: records posted before stop() are drained below
+        size_t length = drain(tail, out, sizeof(out));
+
+        unsigned long dropped = _dropped;
+        if (dropped != reportedDrops && sizeof(out) - length >= LINE_MAX_BYTES) {
+            // Say where the gap is, in the stream itself
+            LogRecord notice;
+            timeval now;
+            gettimeofday(&now, NULL);
+            notice.timeMs = now.tv_sec * 1000UL + now.tv_usec / 1000;
+            notice.level = LOG_WARN;
+            notice.category = LOG_SERVER;
+            notice.length = putNumber(notice.text, dropped - reportedDrops, 0);
+            notice.length += putText(notice.text + notice.length, " log records dropped (ring full)");
+            length += format(notice, out + length);
+            reportedDrops = dropped;
+        }
+
+        if (length > 0) {
+            writeAll(out, length);
+            napNs = MIN_NAP_NS;
+            continue;
+        }
+        if (stopping)
+            break;
+        timespec nap;
+        nap.tv_sec = 0;
+        nap.tv_nsec = napNs;
+        nanosleep(&nap, NULL);
+        if (napNs < MAX_NAP_NS) // Idle server: back off instead of polling the ring a thousand times a second
+            napNs *= 2;
+    }
+    return NULL;
+}
+
+size_t Log::drain(unsigned long& tail, char* out, size_t capacity) // formats published records until the batch is full
+{
+    size_t length = 0;
+    unsigned long count = 0;
+    while (capacity - length >= LINE_MAX_BYTES) {
+        LogRecord& record = _ring[tail & _mask];
+        if (record.sequence != tail + 1) // Not published yet
+            break;
+        __sync_synchronize();
+        length += format(record, out + length);
+        __sync_synchronize(); // Done reading before the slot is handed back
+        record.sequence = tail + _mask + 1;
+        ++tail;
+        ++count;
+    }
+    _written += count; // Once per batch: the counter may share a cache line with the producers' head
+    return length;
+}
+
+// "2026-01-31 13:45:07.042 INFO  conn    New client connected: 5 (IP: 127.0.0.1)"
+// Called by the writer thread, or by one thread at a time while it is not running
+size_t Log::format(const LogRecord& record, char* out)
+{
+    static time_t cachedSecond = static_cast<time_t>(-1);
+    static char cachedStamp[19]; // "YYYY-MM-DD HH:MM:SS": localtime_r() is far too slow to run per record
+
+    time_t seconds = record.timeMs / 1000;
+    if (seconds != cachedSecond) {
+        tm local;
+        localtime_r(&seconds, &local);
+        size_t n = 0;
+        n += putNumber(cachedStamp + n, local.tm_year + 1900, 4);
+        cachedStamp[n++] = '-';
+        n += putNumber(cachedStamp + n, local.tm_mon + 1, 2);
+        cachedStamp[n++] = '-';
+        n += putNumber(cachedStamp + n, local.tm_mday, 2);
+        cachedStamp[n++] = ' ';
+        n += putNumber(cachedStamp + n, local.tm_hour, 2);
+        cachedStamp[n++] = ':';
+        n += putNumber(cachedStamp + n, local.tm_min, 2);
+        cachedStamp[n++] = ':';
+        putNumber(cachedStamp + n, local.tm_sec, 2);
+        cachedSecond = seconds;
+    }
+
+    size_t n = sizeof(cachedStamp);
+    memcpy(out, cachedStamp, n);
+    out[n++] = '.';
+    n += putNumber(out + n, record.timeMs % 1000, 3);
+    out[n++] = ' ';
+
+    size_t start = n;
+    n += putText(out + n, LEVEL_NAMES[record.level]);
+    while (n < start + 6)
+        out[n++] = ' ';
+    start = n;
+    n += putText(out + n, CATEGORY_NAMES[record.category]);
+    while (n < start + 8)
+        out[n++] = ' ';
+
+    memcpy(out + n, record.text, record.length);
+    n += record.length;
+    out[n++] = '\n';
+    return n;
+}
+
+void Log::writeAll(const char* data, size_t length)
+{
+    while (length > 0) {
+        ssize_t written = ::write(STDOUT_FILENO, data, length);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0) // Nowhere to log to: nothing better to do than carry on
+            return;
+        data += written;
+        length -= written;
+    }
+}
+
+bool Log::parseLevel(const std::string& name, LogLevel& level)
+{
+    static const char* const names[] = { "error", "warn", "info", "debug", "trace" };
+    for (int i = LOG_ERROR; i <= LOG_TRACE; ++i) {
+        if (name == names[i]) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Log::parseCategory(const std::string& name, LogCategory& category)
+{
+    for (int i = 0; i < LOG_CATEGORIES; ++i) {
+        if (name == CATEGORY_NAMES[i]) {
+            category = static_cast<LogCategory>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned long Log::getWritten()
+{
+    return _written;
+}
+
+unsigned long Log::getDropped()
+{
+    return _dropped;
+}
+
+unsigned long Log::getSampledOut()
+{
+    return _sampledOut;
+}
+
+LogLine::LogLine(LogLevel level, LogCategory category) : _level(level), _category(category), _length(0)
+{
+}
+
+LogLine::~LogLine()
+{
+    Log::write(_level, _category, _text, _length);
+}
+
+LogLine& LogLine::append(const char* data, size_t length)
+{
+    if (length > LogRecord::TEXT - _length)
+        length = LogRecord::TEXT - _length; // Truncated
+    memcpy(_text + _length, data, length);
+    _length += length;
+    return *this;
+}
+
+LogLine& LogLine::appendUnsigned(unsigned long value, bool negative)
+{
+    char digits[21];
+    size_t count = 0;
+    if (negative)
+        digits[count++] = '-';
+    count += putNumber(digits + count, value, 0);
+    return append(digits, count);
+}
+
+LogLine& LogLine::operator<<(const char* text)
+{
+    return append(text, strlen(text));
+}
+
+LogLine& LogLine::operator<<(const std::string& text)
+{
+    return append(text.data(), text.size());
+}
+
+LogLine& LogLine::operator<<(char c)
+{
+    return append(&c, 1);
+}
+
+LogLine& LogLine::operator<<(int value)
+{
+    return *this << static_cast<long>(value);
+}
+
+LogLine& LogLine::operator<<(unsigned int value)
+{
+    return appendUnsigned(value, false);
+}
+
+LogLine& LogLine::operator<<(long value)
+{
+    if (value < 0)
+        return appendUnsigned(0UL - static_cast<unsigned long>(value), true);
+    return appendUnsigned(value, false);
+}
+
+LogLine& LogLine::operator<<(unsigned long value)
+{
+    return appendUnsigned(value, false);
+}
@@ -0,0 +1,123 @@
+#include "../includes/MessageBuffer.hpp"
+#include <cstring> // for memcpy()
+#include <new>
+
+// Size classes for payload blocks, about 64 KiB per slab. The largest holds a 512-byte line.
+static SlabPool payloads64("message 64", 64, 1024);
+static SlabPool payloads128("message 128", 128, 512);
+static SlabPool payloads256("message 256", 256, 256);
+static SlabPool payloads576("message 576", 576, 113);
+static SlabPool* const payloadPools[] = { &payloads64, &payloads128, &payloads256, &payloads576 };
+static const size_t PAYLOAD_POOLS = sizeof(payloadPools) / sizeof(payloadPools[0]);
+
+static volatile unsigned long heapPayloads = 0;
+
+MessageBuffer::MessageBuffer() : _payload(NULL) {}
+
+MessageBuffer::MessageBuffer(const std::string& data) : _payload(NULL)
+{
+    assign(data.data(), data.length());
+}
+
+MessageBuffer::MessageBuffer(const char* data, size_t length) : _payload(NULL)
+{
+    assign(data, length);
+}
+
+MessageBuffer::MessageBuffer(const MessageBuffer& other) : _payload(other._payload)
+{
+    if (_payload)
+        __sync_add_and_fetch(&_payload->refCount, 1);
+}
+
+MessageBuffer& MessageBuffer::operator=(const MessageBuffer& other)
+{
+    if (_payload != other._payload) {
+        if (other._payload)
+            __sync_add_and_fetch(&other._payload->refCount, 1);
+        release();
+        _payload = other._payload;
+    }
+    return *this;
+}
+
+MessageBuffer::~MessageBuffer()
+{
+    release();
+}
+
+void MessageBuffer::swap(MessageBuffer& other)
+{
+    Payload* payload = _payload;
+    _payload = other._payload;
+    other._payload = payload;
+}
+
+SlabPool* MessageBuffer::poolFor(size_t blockSize) // smallest size class that fits, NULL if none does
+{
+    for (size_t i = 0; i < PAYLOAD_POOLS; ++i)
+        if (blockSize <= payloadPools[i]->getObjectSize())
+            return payloadPools[i];
+    return NULL;
+}
+
+void MessageBuffer::assign(const char* data, size_t length)
+{
+    size_t blockSize = offsetof(Payload, data) + length + 1;
+    SlabPool* pool = poolFor(blockSize);
+    if (pool)
+        _payload = static_cast<Payload*>(pool->allocate());
+    else {
+        _payload = static_cast<Payload*>(::operator new(blockSize));
+        __sync_add_and_fetch(&heapPayloads, 1);
+    }
+    _payload->refCount = 1;
+    _payload->length = length;
+    _payload->pool = pool;
+    memcpy(_payload->data, data, length);
+    _payload->data[length] = '\0';
+}
+
+void MessageBuffer::release()
+{
+    if (_payload && __sync_sub_and_fetch(&_payload->refCount, 1) == 0) {
+        if (_payload->pool)
+            _payload->pool->release(_payload);
+        else
+            ::operator delete(_payload);
+    }
+    _payload = NULL;
+}
+
+const char* MessageBuffer::data() const
+{
+    return _payload ? _payload->data : "";
+}
+
+size_t MessageBuffer::length() const
+{
+    return _payload ? _payload->length : 0;
+}
+
+bool MessageBuffer::empty() const
+{
+    return length() == 0;
+}
+
+size_t MessageBuffer::useCount() const
+{
+    return _payload ? _payload->refCount : 0;
+}
+
+std::vector<PoolStats> MessageBuffer::getPoolStats()
+{
+    std::vector<PoolStats> stats;
+    for (size_t i = 0; i < PAYLOAD_POOLS; ++i)
+        stats.push_back(payloadPools[i]->getStats());
+    return stats;
+}
+
+unsigned long MessageBuffer::getHeapPayloads()
+{
+    return heapPayloads;
+}
@@ -0,0 +1,130 @@
+#include "../includes/MessageView.hpp"
+#include <cstring>
+
+const size_t MessageView::MAX_PARAMS;
+
+StringSlice::StringSlice() : data(""), len(0) {}
+
+StringSlice::StringSlice(const char* data, size_t len) : data(data), len(len) {}
+
+size_t StringSlice::length() const
+{
+    return len;
+}
+
+bool StringSlice::empty() const
+{
+    return len == 0;
+}
+
+char StringSlice::operator[](size_t i) const
+{
+    return data[i];
+}
+
+bool StringSlice::operator==(const char* literal) const
+{
+    size_t literalLength = strlen(literal);
+    return literalLength == len && memcmp(data, literal, len) == 0;
+}
+
+bool StringSlice::operator==(const std::string& other) const
+{
+    return other.length() == len && other.compare(0, len, data, len) == 0;
+}
+
+bool StringSlice::operator!=(const char* literal) const
+{
+    return !(*this == literal);
+}
+
+std::string StringSlice::str() const
+{
+    return std::string(data, len);
+}
+
+MessageView::MessageView() : _paramCount(0) {}
+
+// Splits a line without copying it. Runs of spaces separate tokens, a parameter
+// starting with ':' takes the rest of the line (an empty trailing is dropped), and
+// the 15th parameter takes the rest of the line as RFC 1459 allows.
+bool MessageView::parse(const char* line, size_t length)
+{
+    size_t pos = 0;
+    _prefix = StringSlice();
+    _command = StringSlice();
+    _paramCount = 0;
+
+    // Skip leading spaces
+    while (pos < length && line[pos] == ' ')
+        pos++;
+
+    // Optional source prefix
+    if (pos < length && line[pos] == ':') {
+        size_t start = ++pos;
+        while (pos < length && line[pos] != ' ')
+            pos++;
+        _prefix = StringSlice(line + start, pos - start);
+        while (pos < length && line[pos] == ' ')
+            pos++;
+    }
+
+    size_t start = pos;
+    while (pos < length && line[pos] != ' ')
+        pos++;
+    if (pos == start)
+        return false;
+    _command = StringSlice(line + start, pos - start);
+
+    while (pos < length) {
+        while (pos < length && line[pos] == ' ')
+            pos++;
+        if (pos >= length)
+            break;
+
+        if (line[pos] == ':' || _paramCount == MAX_PARAMS - 1) {
+            if (line[pos] == ':')
+                pos++;
+            if (pos < length)
+                _params[_paramCount++] = StringSlice(line + pos, length - pos);
+            break;
+        }
+
+        start = pos;
+        while (pos < length && line[pos] != ' ')
+            pos++;
+        _params[_paramCount++] = StringSlice(line + start, pos - start);
+    }
+    return true;
+}
+
+const StringSlice& MessageView::prefix() const
+{
+    return _prefix;
+}
+
+const StringSlice& MessageView::command() const
+{
+    return _command;
+}
+
+size_t MessageView::size() const
+{
+    return _paramCount;
+}
+
+const StringSlice& MessageView::operator[](size_t i) const
+{
+    return _params[i];
+}
+
+std::string MessageView::join(size_t from) const // parameters from..end separated by single spaces
+{
+    std::string joined;
+    for (size_t i = from; i < _paramCount; ++i) {
+        if (i > from)
+            joined += ' ';
+        joined.append(_params[i].data, _params[i].len);
+    }
+    return joined;
+}
@@ -0,0 +1,82 @@
+#include "../includes/Metrics.hpp"
+#include <time.h> // for clock_gettime()
+
+unsigned long monotonicNs()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000UL + now.tv_nsec;
+}
+
+Histogram::Histogram() : count(0), sum(0), max(0)
+{
+    for (size_t i = 0; i < BUCKETS; ++i)
+        buckets[i] = 0;
+}
+
+void Histogram::record(unsigned long value)
+{
+    size_t bucket = 0;
+#if defined(__GNUC__)
+    if (value != 0)
+        bucket = sizeof(unsigned long) * 8 - __builtin_clzl(value);
+#else
+    for (unsigned long v = value; v != 0; v >>= 1)
+        ++bucket;
+#endif
+    if (bucket >= BUCKETS)
+        bucket = BUCKETS - 1;
+    ++buckets[bucket];
+    ++count;
+    sum += value;
+    if (value > max)
+        max = value;
+}
+
+void Histogram::merge(const Histogram& other)
+{
+    for (size_t i = 0; i < BUCKETS; ++i)
+        buckets[i] += other.buckets[i];
+    count += other.count;
+    sum += other.sum;
+    if (other.max > max)
+        max = other.max;
+}
+
+unsigned long Histogram::percentile(unsigned int perMille) const
+{
+    if (count == 0)
+        return 0;
+    unsigned long rank = (count * perMille + 999) / 1000; // 1-based rank of the value asked for
+    if (rank == 0)
+        rank = 1;
+    unsigned long seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            unsigned long bound = (i == 0) ? 0 : (1UL << i) - 1;
+            return (bound < max) ? bound : max;
+        }
+    }
+    return max;
+}
+
+LoopMetrics::LoopMetrics() : bytesIn(0), bytesOut(0)
+{
+}
+
+void LoopMetrics::merge(const LoopMetrics& other)
+{
+    bytesIn += other.bytesIn;
+    bytesOut += other.bytesOut;
+    iterationNs.merge(other.iterationNs);
+    readyFds.merge(other.readyFds);
+}
+
+CommandMetrics::CommandMetrics() : calls(0), bytes(0)
+{
+}
+
+CoreMetrics::CoreMetrics() : unknownCommands(0)
+{
+}
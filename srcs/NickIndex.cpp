@@ -0,0 +1,43 @@
+#include "../includes/NickIndex.hpp"
+
+NickIndex::NickIndex()
+{
+}
+
+Client* NickIndex::find(const std::string& nickname) const
+{
+    const Symbol* symbol = _symbols.find(nickname);
+    return symbol ? _clients[symbol->id] : NULL;
+}
+
+const Symbol* NickIndex::insert(const std::string& nickname, Client* client)
+{
+    const Symbol* symbol = _symbols.add(nickname);
+    if (!symbol)
+        return NULL;
+    if (_clients.size() < _symbols.idLimit())
+        _clients.resize(_symbols.idLimit(), NULL);
+    _clients[symbol->id] = client;
+    return symbol;
+}
+
+bool NickIndex::erase(const std::string& nickname)
+{
+    const Symbol* symbol = _symbols.find(nickname);
+    if (!symbol)
+        return false;
+    _clients[symbol->id] = NULL;
+    _symbols.remove(symbol);
+    return true;
+}
+
+// The client keeps its Symbol; only the name in it changes
+bool NickIndex::rename(const Symbol* nickname, const std::string& newNickname)
+{
+    return _symbols.rename(nickname, newNickname);
+}
+
+size_t NickIndex::size() const
+{
+    return _symbols.size();
+}
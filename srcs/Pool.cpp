@@ -0,0 +1,85 @@
+#include "../includes/Pool.hpp"
+#include <new>
+
+PoolStats::PoolStats() : name(""), objectSize(0), slabs(0), capacity(0), inUse(0), peakInUse(0), allocations(0), frees(0) {}
+
+SlabPool::SlabPool(const char* name, size_t objectSize, size_t objectsPerSlab)
+    : _name(name), _objectSize((objectSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT), _objectsPerSlab(objectsPerSlab), _free(NULL)
+{
+    if (_objectSize < sizeof(FreeSlot))
+        _objectSize = ALIGNMENT;
+    _stats.name = _name;
+    _stats.objectSize = _objectSize;
+    pthread_mutex_init(&_mutex, NULL);
+}
+
+SlabPool::~SlabPool()
+{
+    for (size_t i = 0; i < _slabs.size(); ++i)
+        ::operator delete(_slabs[i]);
+    pthread_mutex_destroy(&_mutex);
+}
+
+void SlabPool::grow() // threads a new slab onto the free list, lowest address first
+{
+    char* slab = static_cast<char*>(::operator new(_objectSize * _objectsPerSlab));
+    try {
+        _slabs.push_back(slab);
+    } catch (...) {
+        ::operator delete(slab);
+        throw;
+    }
+    for (size_t i = _objectsPerSlab; i-- > 0; ) {
+        FreeSlot* slot = reinterpret_cast<FreeSlot*>(slab + i * _objectSize);
+        slot->next = _free;
+        _free = slot;
+    }
+    _stats.slabs++;
+    _stats.capacity += _objectsPerSlab;
+}
+
+void* SlabPool::allocate()
+{
+    pthread_mutex_lock(&_mutex);
+    if (!_free) {
+        try {
+            grow();
+        } catch (...) {
+            pthread_mutex_unlock(&_mutex);
+            throw;
+        }
+    }
+    FreeSlot* slot = _free;
+    _free = slot->next;
+    _stats.allocations++;
+    if (++_stats.inUse > _stats.peakInUse)
+        _stats.peakInUse = _stats.inUse;
+    pthread_mutex_unlock(&_mutex);
+    return slot;
+}
+
+void SlabPool::release(void* object)
+{
+    if (!object)
+        return;
+    FreeSlot* slot = static_cast<FreeSlot*>(object);
+    pthread_mutex_lock(&_mutex);
+    slot->next = _free; // LIFO: the next allocation reuses the slot that is still in cache
+    _free = slot;
+    _stats.frees++;
+    _stats.inUse--;
+    pthread_mutex_unlock(&_mutex);
+}
+
+size_t SlabPool::getObjectSize() const
+{
+    return _objectSize;
+}
+
+PoolStats SlabPool::getStats() const
+{
+    pthread_mutex_lock(&_mutex);
+    PoolStats stats = _stats;
+    pthread_mutex_unlock(&_mutex);
+    return stats;
+}
@@ -0,0 +1,855 @@
+#include "../includes/Reactor.hpp"
+#include "../includes/Server.hpp"
+#include "../includes/Command.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring> // for memset
+#include <unistd.h> // for close()
+#include <fcntl.h> // File control definitions
+#include <netinet/in.h> // Internet address family
+#include <netinet/tcp.h> // for TCP_NODELAY
+#include <sys/socket.h> // Socket definitions
+#include <arpa/inet.h> // Internet operations definitions
+#include <time.h> // for clock_gettime()
+
+static const unsigned long TIMER_TICK_MS = 100; // Resolution of the keepalive and registration deadlines
+
+static unsigned long monotonicMs()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000UL + now.tv_nsec / 1000000;
+}
+
+CoreEvent::CoreEvent(Type type, Client* client) : type(type), client(client), spec(NULL) {}
+
+ReactorMessage::ReactorMessage(Type type, Client* client, const MessageBuffer& message) : type(type), client(client), message(message) {}
+
+Reactor::Reactor(Server& server, int id, int port, const ServerConfig& config) : _server(server), _id(id), _port(port), _backend(config.backend), _threaded(config.threads > 1), _listenFd(-1), _epollFd(-1), _started(false), _nextLoopbackId(0), _flood(config.flood), _throttleWaitMs(0), _sendQLimit(config.sendQ), _timers(monotonicMs(), TIMER_TICK_MS), _now(monotonicMs()), _clockSkewMs(0), _pingIntervalMs(config.pingInterval * 1000UL), _pingTimeoutMs(config.pingTimeout * 1000UL), _registrationTimeoutMs(config.registrationTimeout * 1000UL), _wakeNs(0), _trace(server.getTrace())
+{
+    pthread_mutex_init(&_metricsMutex, NULL);
+
+    pollfd wakePoll;
+    wakePoll.fd = _inbox.getWakeFd();
+    wakePoll.events = POLLIN;
+    wakePoll.revents = 0;
+    _pollFds.push_back(wakePoll);
+    _pollClients.push_back(NULL);
+
+    if (_backend == BACKEND_LOOPBACK)
+        return;
+    setupListener();
+    if (_backend == BACKEND_EPOLL)
+        setupEpoll();
+}
+
+Reactor::~Reactor()
+{
+    // Delete all clients
+    for (size_t fd = 0; fd < _clients.size(); ++fd) {
+        if (_clients[fd]) {
+            _clients[fd]->getTransport().close();
+            delete _clients[fd];
+        }
+    }
+    _clients.clear();
+
+    if (_epollFd >= 0)
+        close(_epollFd);
+    if (_listenFd >= 0)
+        close(_listenFd);
+    pthread_mutex_destroy(&_metricsMutex);
+}
+
+void Reactor::setupListener() // handles the creation and configuration of the listening socket. This includes socket creation, binding, and listening.
+{
+    _listenFd = socket(AF_INET, SOCK_STREAM, 0); // socket():creates a new socket| AF_INET:use IPv4| SOCK_STREAM: Socket type (TCP) | 0: Default protocol
+
+    if (_listenFd < 0)
+        throw std::runtime_error("Failed to create socket");
+
+    // Configure socket options
+    int opt = 1;
+    if (setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        close(_listenFd);
+        throw std::runtime_error("setsockopt SO_REUSEADDR failed");
+    }
+
+    // Every reactor binds its own socket to the same port and the kernel spreads new connections across them
+    if (_threaded) {
+#ifdef SO_REUSEPORT
+        if (setsockopt(_listenFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+            close(_listenFd);
+            throw std::runtime_error("setsockopt SO_REUSEPORT failed");
+        }
+#else
+        close(_listenFd);
+        throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+    }
+
+    // Set socket to non-blocking mode
+    if (fcntl(_listenFd, F_SETFL, O_NONBLOCK) < 0) {
+        close(_listenFd);
+        throw std::runtime_error("Failed to set socket to non-blocking mode");
+    }
+
+    // IPv4 Structure for server address
+    sockaddr_in serverAddr;
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_addr.s_addr = INADDR_ANY; // 0.0.0.0 - listens(bind) on all available interfaces
+    serverAddr.sin_port = htons(_port); // Converts port number to network byte order
+
+    if (bind(_listenFd, (struct sockaddr *)&serverAddr, sizeof(serverAddr)) < 0) { // Binds socket to the specified port on the local machine
+        close(_listenFd);
+        throw std::runtime_error("Bind failed - port may already be in use");
+    }
+
+    if (listen(_listenFd, SOMAXCONN) < 0) { // Prepares it to listen for incoming connections (a connection burst must not overflow the queue)
+        close(_listenFd);
+        throw std::runtime_error("Listen failed");
+    }
+
+    pollfd pfd;
+    pfd.fd = _listenFd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    _pollFds.push_back(pfd);
+    _pollClients.push_back(NULL);
+}
+
+void Reactor::setupEpoll() // creates the epoll instance and registers the wake pipe and the listening socket
+{
+#ifdef __linux__
+    _epollFd = epoll_create(1); // the size hint is ignored by modern kernels but must be positive
+    if (_epollFd < 0) {
+        close(_listenFd);
+        throw std::runtime_error("Failed to create epoll instance");
+    }
+
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = this; // the reactor itself marks its mailbox wake pipe
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, _inbox.getWakeFd(), &ev) < 0) {
+        close(_epollFd);
+        close(_listenFd);
+        throw std::runtime_error("Failed to register wake pipe with epoll");
+    }
+
+    ev.data.ptr = NULL; // NULL marks the listening socket, clients carry their Client*
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, _listenFd, &ev) < 0) {
+        close(_epollFd);
+        close(_listenFd);
+        throw std::runtime_error("Failed to register server socket with epoll");
+    }
+#else
+    close(_listenFd);
+    throw std::runtime_error("epoll backend is only available on Linux");
+#endif
+}
+
+int Reactor::getId() const
+{
+    return _id;
+}
+
+void Reactor::run() {
+    if (_backend == BACKEND_LOOPBACK)
+        throw std::runtime_error("A loopback reactor is driven by runLoopback()");
+    if (_backend == BACKEND_EPOLL)
+        runEpoll();
+    else
+        runPoll();
+}
+
+void* Reactor::threadMain(void* arg)
+{
+    Reactor* reactor = static_cast<Reactor*>(arg);
+    try {
+        reactor->run();
+    } catch (const std::exception& e) {
+        LogLine(LOG_ERROR, LOG_SERVER) << "Reactor " << reactor->_id << " error: " << e.what();
+        reactor->_server.requestStop();
+    }
+    return NULL;
+}
+
+void Reactor::start()
+{
+    if (pthread_create(&_thread, NULL, &Reactor::threadMain, this) != 0)
+        throw std::runtime_error("Failed to start reactor thread");
+    _started = true;
+}
+
+void Reactor::join()
+{
+    if (_started) {
+        pthread_join(_thread, NULL);
+        _started = false;
+    }
+}
+
+void Reactor::wake()
+{
+    _inbox.wake();
+}
+
+void Reactor::post(std::vector<ReactorMessage>& batch)
+{
+    _inbox.post(batch);
+}
+
+void Reactor::runPoll() {
+    while (!_server.isStopping()) {
+        // Only ask for POLLOUT on clients whose socket was full at the last flush, and leave
+        // POLLIN off while a throttled client's input buffer or a backlogged client's socket is full
+        for (size_t i = 2; i < _pollFds.size(); ++i) {
+            Client* client = _pollClients[i];
+            bool paused = client->isReadBlocked() || client->isBacklogged();
+            _pollFds[i].events = (paused ? 0 : POLLIN) | (client->isWriteArmed() ? POLLOUT : 0);
+        }
+
+        int ret = poll(&_pollFds[0], _pollFds.size(), loopTimeout()); // Waits for events on the monitored file descriptors
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("Poll failed");
+        }
+        beginIteration(ret);
+
+        for (size_t i = 0; i < _pollFds.size() && ret > 0; ++i) // Iterates through all monitored file descriptors
+        {
+            if (_pollFds[i].revents == 0)
+                continue;
+            --ret;
+
+            short revents = _pollFds[i].revents;
+            _pollFds[i].revents = 0;
+
+            if (i == 0) // Mailbox wake pipe, drained by processInbox()
+                continue;
+            if (i == 1) // New incoming connection
+            {
+                if (revents & POLLIN)
+                    acceptNewConnections();
+                continue;
+            }
+
+            Client* client = _pollClients[i];
+            bool alive = true;
+            if ((revents & POLLOUT) || (client->isBacklogged() && (revents & (POLLHUP | POLLERR)))) // Socket can take more of the queued replies (or reports why it cannot)
+                alive = flushClient(client);
+            if (alive && (revents & (POLLHUP | POLLERR))) // The peer went away (reported even with POLLIN off)
+                alive = handleHangUp(client);
+            else if (alive && (revents & POLLIN)) // Data from existing client
+                alive = handleClientData(client);
+            if (!alive) // Entry was erased on disconnect, revisit this slot
+                --i;
+        }
+
+        endIteration();
+    }
+}
+
+void Reactor::runEpoll() {
+#ifdef __linux__
+    epoll_event events[256];
+
+    while (!_server.isStopping()) {
+        int ret = epoll_wait(_epollFd, events, 256, loopTimeout()); // Only returns the descriptors that are actually ready
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("epoll_wait failed");
+        }
+        beginIteration(ret);
+
+        for (int i = 0; i < ret; ++i)
+        {
+            void* owner = events[i].data.ptr;
+            if (owner == this) // Mailbox wake pipe, drained by processInbox()
+                continue;
+            if (owner == NULL) { // New incoming connection(s)
+                acceptNewConnections();
+                continue;
+            }
+
+            Client* client = static_cast<Client*>(owner);
+            bool alive = true;
+            if (events[i].events & EPOLLOUT) // Socket can take more of the queued replies
+                alive = flushClient(client);
+            if (alive && (events[i].events & (EPOLLHUP | EPOLLERR)))
+                handleHangUp(client);
+            else if (alive && (events[i].events & (EPOLLIN | EPOLLRDHUP)))
+                handleClientData(client);
+        }
+
+        endIteration();
+    }
+#endif
+}
+
+void Reactor::runLoopback(const std::vector<Client*>& ready) // the poll() loop body, minus the poll()
+{
+    beginIteration(ready.size());
+    for (size_t i = 0; i < ready.size(); ++i) {
+        Client* client = ready[i];
+        bool alive = true;
+        if (client->isWriteArmed())
+            alive = flushClient(client);
+        if (alive && static_cast<LoopbackTransport&>(client->getTransport()).isReset()) // What poll() reports as POLLHUP
+            handleHangUp(client);
+        else if (alive)
+            handleClientData(client);
+    }
+    endIteration();
+}
+
+void Reactor::advanceClock(unsigned long ms) // takes effect at the next beginIteration()
+{
+    _clockSkewMs += ms;
+}
+
+void Reactor::beginIteration(int ready) // samples the clock once for everything this wakeup does
+{
+    _wakeNs = monotonicNs();
+    _now = _wakeNs / 1000000 + _clockSkewMs;
+    _loopMetrics.readyFds.record(ready);
+}
+
+void Reactor::endIteration() // hands work across threads, then flushes everything this iteration produced
+{
+    processInbox();
+    expireTimers();
+    serviceThrottled();
+    evictClients();
+    if (_threaded)
+        _server.postEvents(_coreEvents);
+    else
+        _server.resetReplyArena(); // Commands ran on this thread
+    flushPendingClients();
+    if (!_traceBatch.empty())
+        _trace->write(_traceBatch);
+
+    _loopMetrics.bytesOut = _flushStats.bytesWritten;
+    _loopMetrics.iterationNs.record(monotonicNs() - _wakeNs);
+    if (_threaded) { // One uncontended lock per iteration; the core thread reads the copy for STATS
+        pthread_mutex_lock(&_metricsMutex);
+        _publishedMetrics = _loopMetrics;
+        pthread_mutex_unlock(&_metricsMutex);
+    }
+}
+
+unsigned long Reactor::traceTime() const // microseconds since recording started, as of this wakeup
+{
+    return (_wakeNs - _trace->getStartNs()) / 1000;
+}
+
+int Reactor::loopTimeout() const // block until an event, the next timer, or until a throttled client can run again
+{
+    int timeout = _timers.msUntilNext(monotonicMs());
+    if (!_throttled.empty() && (timeout < 0 || _throttleWaitMs < static_cast<unsigned long>(timeout)))
+        timeout = static_cast<int>(_throttleWaitMs);
+    return timeout;
+}
+
+void Reactor::expireTimers() // runs the keepalive and registration deadlines that came due
+{
+    _timers.advance(_now, _expired);
+    for (size_t i = 0; i < _expired.size(); ++i) {
+        Timer* timer = _expired[i];
+        if (!timer) // Its client was released by an earlier timer in this batch
+            continue;
+        if (timer->kind == TIMER_REGISTRATION)
+            dropClient(timer->client, "Registration timed out");
+        else
+            keepalive(timer->client);
+    }
+    _expired.clear();
+}
+
+void Reactor::keepalive(Client* client) // PINGs a quiet client, and disconnects it if the PING went unanswered
+{
+    unsigned long idle = _now - client->getLastActivity();
+    if (client->getPingSentAt() != 0 && client->getLastActivity() < client->getPingSentAt()) {
+        std::ostringstream reason;
+        reason << "Ping timeout: " << idle / 1000 << " seconds";
+        dropClient(client, reason.str());
+        return;
+    }
+
+    client->setPingSentAt(0);
+    if (idle >= _pingIntervalMs) {
+        client->releaseIdleOutput(); // Quiet for a whole interval: its reply slots go back to the heap
+        queueMessage(*client, MessageBuffer("PING :ircserv\r\n"));
+        client->setPingSentAt(_now);
+        _timers.schedule(client->getKeepaliveTimer(), _now + _pingTimeoutMs);
+    } else { // Heard from since the timer was armed: check again a full interval after that
+        _timers.schedule(client->getKeepaliveTimer(), client->getLastActivity() + _pingIntervalMs);
+    }
+}
+
+void Reactor::clientRegistered(Client* client) // the client authenticated in time
+{
+    _timers.cancel(client->getRegistrationTimer());
+}
+
+void Reactor::dropClient(Client* client, const std::string& reason) // disconnects a client the server gave up on, telling it why
+{
+    if (client->isClosing()) // Already told, and on its way out
+        return;
+    client->abortOutput("ERROR :Closing Link: " + client->getIpAddr() + " (" + reason + ")\r\n");
+    client->setQuitReason(reason);
+    closeClient(client);
+}
+
+void Reactor::serviceThrottled() // gives every waiting client one turn per iteration, in arrival order
+{
+    if (_throttled.empty())
+        return;
+
+    unsigned long now = monotonicMs();
+    size_t turns = _throttled.size();
+    for (size_t n = 0; n < turns; ++n) {
+        Client* client = _throttled.front();
+        _throttled.pop_front();
+        unsigned long since = client->getThrottledSince();
+        client->setThrottled(false);
+        if (client->isClosing())
+            continue;
+
+        size_t ran = dispatchLines(client);
+        if (ran > 0) {
+            client->setLastActivity(_now);
+            _floodStats.throttledLines += ran;
+            if (now - since > _floodStats.maxDelayMs)
+                _floodStats.maxDelayMs = now - since;
+        }
+
+        if (client->isThrottled()) {
+            client->setThrottled(true, since); // Still waiting: keep the original start for the delay figure
+        } else if (client->isReadBlocked()) {
+            // Lines ran and freed buffer space: resume reading (an edge-triggered socket will not report again)
+            client->setReadBlocked(false);
+            handleClientData(client);
+        }
+    }
+
+    // Sleep no longer than the soonest waiting client needs to earn its next token
+    _throttleWaitMs = 1000;
+    for (std::deque<Client*>::const_iterator it = _throttled.begin(); it != _throttled.end(); ++it) {
+        unsigned long wait = (*it)->getBucket().msUntilToken(_flood);
+        if (wait < _throttleWaitMs)
+            _throttleWaitMs = wait;
+    }
+}
+
+void Reactor::evictClients() // disconnects the clients that went over their SendQ during this iteration
+{
+    // Inline, their QUIT notices can push more peers over the limit, which land here too
+    while (!_evictions.empty()) {
+        Client* client = _evictions.back();
+        _evictions.pop_back();
+        _flushStats.sendQEvictions++;
+        if (Log::shouldLog(LOG_WARN, LOG_CONNECTION))
+            LogLine(LOG_WARN, LOG_CONNECTION) << "Client " << client->getSocketFd() << " exceeded its SendQ (" << _sendQLimit << " bytes)";
+        dropClient(client, "Max SendQ exceeded");
+    }
+}
+
+void Reactor::watch(int fd, Client* client) // adds a client socket to the event backend
+{
+    if (_backend == BACKEND_LOOPBACK)
+        return;
+    if (_backend == BACKEND_EPOLL) {
+#ifdef __linux__
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = client;
+        if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+            throw std::runtime_error("Failed to register client socket with epoll");
+#endif
+    } else {
+        pollfd clientPoll;
+        clientPoll.fd = fd;
+        clientPoll.events = POLLIN;
+        clientPoll.revents = 0;
+        _pollFds.push_back(clientPoll);
+        _pollClients.push_back(client);
+    }
+}
+
+void Reactor::unwatch(Client* client) // stops all event notifications for a client socket
+{
+    int clientFd = client->getSocketFd();
+    if (_backend == BACKEND_LOOPBACK)
+        return;
+    if (_backend == BACKEND_EPOLL) {
+#ifdef __linux__
+        epoll_ctl(_epollFd, EPOLL_CTL_DEL, clientFd, NULL);
+#endif
+        return;
+    }
+    for (size_t i = 2; i < _pollFds.size(); ++i) {
+        if (_pollFds[i].fd == clientFd) {
+            _pollFds.erase(_pollFds.begin() + i);
+            _pollClients.erase(_pollClients.begin() + i);
+            break;
+        }
+    }
+}
+
+void Reactor::acceptNewConnections() //accepting new client connections
+{
+    // Edge-triggered notifications only fire once per burst, so drain the whole backlog
+    while (true) {
+        sockaddr_in clientAddr;
+        socklen_t len = sizeof(clientAddr);
+        int clientFd = accept(_listenFd, (struct sockaddr *)&clientAddr, &len);
+        if (clientFd < 0)
+            return;
+
+        fcntl(clientFd, F_SETFL, O_NONBLOCK);
+        // Replies are already coalesced into one writev() per iteration: Nagle would only hold the
+        // next batch back until the peer's delayed ACK (40 ms on Linux)
+        int noDelay = 1;
+        setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        std::string ip = inet_ntoa(clientAddr.sin_addr); // converts the client's IP address to a human-readable string
+        Client* client = new Client(new SocketTransport(clientFd), ip);
+        client->setReactor(this);
+
+        try {
+            watch(clientFd, client);
+        } catch (const std::exception& e) {
+            LogLine(LOG_ERROR, LOG_CONNECTION) << e.what();
+            close(clientFd);
+            delete client;
+            continue;
+        }
+        adopt(client);
+    }
+}
+
+int Reactor::reserveLoopbackId()
+{
+    if (_freeLoopbackIds.empty())
+        return _nextLoopbackId++;
+    int id = _freeLoopbackIds.back();
+    _freeLoopbackIds.pop_back();
+    return id;
+}
+
+Client* Reactor::attach(Transport* transport, const std::string& ip) // an in-memory connection, handed over by the caller instead of accept()
+{
+    Client* client = new Client(transport, ip);
+    client->setReactor(this);
+    adopt(client);
+    return client;
+}
+
+void Reactor::adopt(Client* client) // registers a new connection: client tables, deadlines, and the command layer
+{
+    int clientFd = client->getSocketFd();
+    const std::string& ip = client->getIpAddr();
+    if (static_cast<size_t>(clientFd) >= _clients.size())
+        _clients.resize(clientFd + 1, NULL);
+    _clients[clientFd] = client;
+    client->setConnectionId(_server.nextConnectionId());
+    if (_trace)
+        TraceWriter::encode(_traceBatch, TRACE_CONNECT, traceTime(), client->getConnectionId());
+
+    client->setLastActivity(_now);
+    client->getKeepaliveTimer().kind = TIMER_KEEPALIVE;
+    client->getRegistrationTimer().kind = TIMER_REGISTRATION;
+    if (_pingIntervalMs > 0)
+        _timers.schedule(client->getKeepaliveTimer(), _now + _pingIntervalMs);
+    if (_registrationTimeoutMs > 0)
+        _timers.schedule(client->getRegistrationTimer(), _now + _registrationTimeoutMs);
+
+    if (Log::shouldLog(LOG_INFO, LOG_CONNECTION))
+        LogLine(LOG_INFO, LOG_CONNECTION) << "New client connected: " << clientFd << " (IP: " << ip << ")";
+
+    if (_threaded)
+        _coreEvents.push_back(CoreEvent(CoreEvent::CONNECT, client));
+    else
+        _server.clientConnected(client);
+}
+
+bool Reactor::handleClientData(Client* client) //processes data received from a client, returns false if it disconnected
+{
+    InputBuffer& input = client->getInput();
+
+    // Read until the socket is drained: required for edge-triggered epoll, and saves wakeups with poll()
+    while (true) {
+        if (client->isWriteArmed()) { // Not reading its replies: stop taking commands until the socket drains
+            client->setBacklogged(true);
+            break;
+        }
+        if (input.writable() == 0) { // Full of lines waiting for flood budget: let TCP push back until they run
+            client->setReadBlocked(true);
+            break;
+        }
+        input.lend(_readScratch); // Unless it is holding bytes already, the client's buffer reads into the reactor's
+        ssize_t bytes = client->getTransport().receive(input.writePtr(), input.writable());
+        if (bytes > 0) {
+            input.commit(bytes);
+            client->setLastActivity(_now);
+            _loopMetrics.bytesIn += bytes;
+            dispatchLines(client);
+            continue;
+        }
+        input.settle();
+        if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (bytes < 0 && errno == EINTR)
+            continue;
+
+        closeClient(client);
+        return false;
+    }
+    return true;
+}
+
+bool Reactor::handleHangUp(Client* client) // the peer reset the connection or the socket failed, returns false once the client is closed
+{
+    if (!client->isReadBlocked())
+        return handleClientData(client); // Reading ends at the error or the end of the stream
+    // Its input is full of lines waiting for flood budget, so nothing reads the socket to see the error, and poll()
+    // would report it on every call. Nobody is left to read the replies either: drop the lines and close now.
+    closeClient(client);
+    return false;
+}
+
+size_t Reactor::dispatchLines(Client* client) // hands complete lines to the command layer, in place, while the client has budget
+{
+    InputBuffer& input = client->getInput();
+    TokenBucket& bucket = client->getBucket();
+    const char* line;
+    size_t length;
+    InputBuffer::LineStatus status;
+    size_t dispatched = 0;
+
+    if (_flood.enabled())
+        bucket.refill(monotonicMs(), _flood);
+
+    while (true) // Process complete commands (terminated by newline)
+    {
+        if (client->isEvicting())
+            break;
+        if (_flood.enabled() && !bucket.hasToken()) {
+            // Over budget: the rest stays buffered and runs in a later iteration
+            if (!input.empty() && !client->isThrottled()) {
+                client->setThrottled(true, monotonicMs());
+                _throttled.push_back(client);
+            }
+            break;
+        }
+        if ((status = input.nextLine(line, length)) == InputBuffer::LINE_NONE)
+            break;
+        bucket.take();
+        ++dispatched;
+
+        if (status == InputBuffer::LINE_TOO_LONG) { // ERR_INPUTTOOLONG
+            queueMessage(*client, MessageBuffer(":ircserv 417 * :Input line was too long\r\n"));
+            continue;
+        }
+        if (_trace) // Lines held back by flood control are stamped when they run, not when they arrived
+            TraceWriter::encode(_traceBatch, TRACE_LINE, traceTime(), client->getConnectionId(), line, length);
+        if (_threaded) { // Parsed here: the core thread only runs the command
+            _coreEvents.push_back(CoreEvent(CoreEvent::LINE, client));
+            CoreEvent& event = _coreEvents.back();
+            MessageBuffer bytes(line, length);
+            event.line.swap(bytes); // The view points into this block, which stays put however the event is copied
+            if (!Command::parseCommand(event.line.data(), length, event.message, event.spec))
+                _coreEvents.pop_back();
+        } else {
+            _server.clientLine(*client, line, length);
+        }
+    }
+    input.settle();
+    return dispatched;
+}
+
+void Reactor::queueMessage(Client& client, const MessageBuffer& message) // coalesced with the client's other replies until the end of the loop iteration
+{
+    if (client.isClosing() || client.isEvicting())
+        return;
+    size_t queued = client.getQueuedBytes() + message.length();
+    if (_sendQLimit > 0 && queued > _sendQLimit / 2 && (!client.isWriteArmed() || queued > _sendQLimit)) {
+        // One iteration can queue a whole burst: past half the limit, hand the backlog to the kernel
+        // now instead of at the end of the iteration. A write error is left for that final flush.
+        if (!client.flushOutput(_flushStats))
+            return;
+        if (client.hasPendingOutput() && !client.isWriteArmed())
+            setWriteInterest(&client, true); // Socket full: also pauses this client's own reads
+        if (client.getQueuedBytes() + message.length() > _sendQLimit) {
+            client.setEvicting(true);
+            _evictions.push_back(&client);
+            return;
+        }
+    }
+    client.queueMessage(message);
+    if (!client.isFlushScheduled()) {
+        client.setFlushScheduled(true);
+        _pendingFlush.push_back(&client);
+    }
+}
+
+bool Reactor::flushClient(Client* client) // writes queued replies, returns false if the client had to be disconnected
+{
+    if (!client->flushOutput(_flushStats)) {
+        closeClient(client);
+        return false;
+    }
+    bool blocked = client->hasPendingOutput();
+    if (blocked != client->isWriteArmed())
+        setWriteInterest(client, blocked);
+    if (!blocked && client->isBacklogged()) {
+        // Caught up: take commands again (an edge-triggered socket will not report what arrived meanwhile)
+        client->setBacklogged(false);
+        return handleClientData(client);
+    }
+    return true;
+}
+
+void Reactor::flushPendingClients() // one writev() per client for everything queued during this iteration
+{
+    // Disconnects can queue QUIT notices for more clients, so the list may grow while we walk it
+    for (size_t i = 0; i < _pendingFlush.size(); ++i) {
+        Client* client = _pendingFlush[i];
+        client->setFlushScheduled(false);
+        if (!client->isWriteArmed() && !client->isClosing()) // Still full: the writable event will flush it
+            flushClient(client);
+    }
+    _pendingFlush.clear();
+}
+
+void Reactor::setWriteInterest(Client* client, bool enable) // poll() rebuilds its events every iteration, epoll needs a re-arm
+{
+    client->setWriteArmed(enable);
+    if (_backend != BACKEND_EPOLL) // poll() rebuilds its events every iteration, loopback has none
+        return;
+#ifdef __linux__
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    if (enable)
+        ev.events |= EPOLLOUT; // MOD re-arms the edge, so an already-writable socket reports at once
+    ev.data.ptr = client;
+    epoll_ctl(_epollFd, EPOLL_CTL_MOD, client->getSocketFd(), &ev);
+#endif
+}
+
+void Reactor::processInbox() // applies the deliveries and releases posted by the core thread
+{
+    _inbox.take(_inboxBatch);
+    for (size_t i = 0; i < _inboxBatch.size(); ++i) {
+        ReactorMessage& msg = _inboxBatch[i];
+        if (msg.type == ReactorMessage::DELIVER)
+            queueMessage(*msg.client, msg.message);
+        else if (msg.type == ReactorMessage::REGISTERED)
+            clientRegistered(msg.client);
+        else
+            releaseClient(msg.client);
+    }
+    _inboxBatch.clear();
+}
+
+void Reactor::closeClient(Client* client) // starts a disconnect: inline it completes at once, threaded the core thread cleans up first
+{
+    // Threaded, a closing client stays until the core thread releases it, so a second deadline in the same
+    // expireTimers() batch or a SendQ eviction later in the iteration can reach it again: close it only once
+    if (client->isClosing())
+        return;
+    _timers.cancel(client->getKeepaliveTimer());
+    _timers.cancel(client->getRegistrationTimer());
+    if (_trace)
+        TraceWriter::encode(_traceBatch, TRACE_CLOSE, traceTime(), client->getConnectionId());
+    if (!_threaded) {
+        _server.clientDisconnected(client);
+        releaseClient(client);
+        return;
+    }
+    // Keep the fd open until the core thread releases the client, so its number cannot be reused meanwhile
+    client->setClosing(true);
+    unwatch(client);
+    _coreEvents.push_back(CoreEvent(CoreEvent::DISCONNECT, client));
+}
+
+void Reactor::releaseClient(Client* client) // closes the socket and frees the client once no thread refers to it anymore
+{
+    int clientFd = client->getSocketFd();
+
+    // Forget a pending turn in the flood control queue
+    if (client->isThrottled()) {
+        for (std::deque<Client*>::iterator it = _throttled.begin(); it != _throttled.end(); ++it) {
+            if (*it == client) {
+                _throttled.erase(it);
+                break;
+            }
+        }
+    }
+
+    // Forget timers that came due in the batch expireTimers() is running
+    for (size_t i = 0; i < _expired.size(); ++i) {
+        if (_expired[i] && _expired[i]->client == client)
+            _expired[i] = NULL;
+    }
+
+    // Forget a pending SendQ eviction
+    if (client->isEvicting()) {
+        for (size_t i = 0; i < _evictions.size(); ++i) {
+            if (_evictions[i] == client) {
+                _evictions.erase(_evictions.begin() + i);
+                break;
+            }
+        }
+    }
+
+    // Forget any flush scheduled for this iteration
+    if (client->isFlushScheduled()) {
+        for (size_t i = 0; i < _pendingFlush.size(); ++i) {
+            if (_pendingFlush[i] == client) {
+                _pendingFlush.erase(_pendingFlush.begin() + i);
+                break;
+            }
+        }
+    }
+
+    if (!client->isClosing())
+        unwatch(client);
+
+    // Close socket (this also drops it from the epoll interest list)
+    client->getTransport().close();
+
+    // Delete client
+    _clients[clientFd] = NULL;
+    if (_backend == BACKEND_LOOPBACK)
+        _freeLoopbackIds.push_back(clientFd);
+    delete client;
+}
+
+const FloodStats& Reactor::getFloodStats() const
+{
+    return _floodStats;
+}
+
+LoopMetrics Reactor::getLoopMetrics() const
+{
+    if (!_threaded)
+        return _loopMetrics;
+    pthread_mutex_lock(&_metricsMutex);
+    LoopMetrics copy = _publishedMetrics;
+    pthread_mutex_unlock(&_metricsMutex);
+    return copy;
+}
+
+const FlushStats& Reactor::getFlushStats() const
+{
+    return _flushStats;
+}
@@ -1,238 +1,316 @@
 #include "../includes/Server.hpp"
 #include "../includes/Command.hpp"
-#include <iostream>
 #include <stdexcept>
+#include <cerrno>
+#include <poll.h> // for poll()
 
-Server::Server(int port, const std::string& password) : _port(port), _password(password), _serverSocket(-1)
+ServerConfig::ServerConfig() : backend(BACKEND_POLL), threads(1), sendQ(1024 * 1024), pingInterval(120), pingTimeout(60), registrationTimeout(30) {}
+
+Server::Server(int port, const std::string& password, const ServerConfig& config) : _port(port), _password(password), _config(config), _threaded(config.threads > 1), _stopRequested(0), _trace(NULL), _nextConnectionId(0)
 {
-    setupServerSocket();
+    Command::buildDispatchTable();
+    if (_config.backend == BACKEND_LOOPBACK && _threaded)
+        throw std::runtime_error("The loopback backend runs a single reactor");
+
+    // Opened before the reactors so that none of them can see a client before recording starts
+    if (!_config.recordPath.empty())
+        _trace = new TraceWriter(_config.recordPath, monotonicNs());
+
+    int count = _threaded ? _config.threads : 1;
+    try {
+        for (int i = 0; i < count; ++i)
+            _reactors.push_back(new Reactor(*this, i, _port, _config));
+    } catch (...) {
+        for (size_t i = 0; i < _reactors.size(); ++i)
+            delete _reactors[i];
+        delete _trace;
+        throw;
+    }
+    _outboxes.resize(count);
+
+    if (Log::shouldLog(LOG_INFO, LOG_SERVER)) {
+        LogLine up(LOG_INFO, LOG_SERVER);
+        if (_config.backend == BACKEND_LOOPBACK)
+            up << "Server is up with the loopback backend (in-memory clients, no sockets)";
+        else
+            up << "Server is up and running on port " << _port;
+        if (_threaded)
+            up << " (" << count << " reactor threads)";
+    }
 }
 
 Server::~Server()
 {
-    // Delete all clients
-    for (std::map<int, Client*>::iterator it = _clients.begin(); it != _clients.end(); ++it) {
-        delete it->second;
+    // Stop and join the reactor threads before tearing down what they point to
+    requestStop();
+    for (size_t i = 0; i < _reactors.size(); ++i)
+        _reactors[i]->join();
+
+    if (Log::shouldLog(LOG_INFO, LOG_SERVER)) {
+        FlushStats stats = getFlushStats();
+        LogLine(LOG_INFO, LOG_SERVER) << "Flush stats: " << stats.messagesWritten << " messages, " << stats.bytesWritten << " bytes in "
+                                      << stats.writeCalls << " writev() calls (" << stats.syscallsSaved() << " syscalls saved), "
+                                      << stats.sendQEvictions << " SendQ evictions";
+        FloodStats flood = getFloodStats();
+        LogLine(LOG_INFO, LOG_SERVER) << "Flood stats: " << flood.throttledLines << " throttled lines, max queueing delay " << flood.maxDelayMs << " ms";
     }
-    _clients.clear();
 
-    // Delete all channels
-    for (std::map<std::string, Channel*>::iterator it = _channels.begin(); it != _channels.end(); ++it) {
-        delete it->second;
-    }
+    // Delete all channels first: a channel drops its members' back-references, so they must still exist
+    for (size_t i = 0; i < _channels.size(); ++i)
+        delete _channels[i];
     _channels.clear();
 
-    close(_serverSocket);
+    // Delete all reactors (and with them every client)
+    for (size_t i = 0; i < _reactors.size(); ++i)
+        delete _reactors[i];
+    _reactors.clear();
+    _clients.clear();
+    delete _trace; // Last: every reactor holds a pointer to it
 }
 
-void Server::setupServerSocket() // handles the creation and configuration of the server socket. This includes socket creation, binding, and listening.
-{
-    _serverSocket = socket(AF_INET, SOCK_STREAM, 0); // socket():creates a new socket| AF_INET:use IPv4| SOCK_STREAM: Socket type (TCP) | 0: Default protocol
-    
-    if (_serverSocket < 0)
-        throw std::runtime_error("Failed to create socket");
-
-    // Configure socket options
-    int opt = 1;
-    if (setsockopt(_serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        close(_serverSocket);
-        throw std::runtime_error("setsockopt SO_REUSEADDR failed");
+void Server::run() {
+    if (!_threaded) {
+        _reactors[0]->run(); // Single reactor: accept, I/O and commands all on this thread
+        return;
     }
 
-    // Set socket to non-blocking mode
-    if (fcntl(_serverSocket, F_SETFL, O_NONBLOCK) < 0) {
-        close(_serverSocket);
-        throw std::runtime_error("Failed to set socket to non-blocking mode");
-    }
-    
-    // IPv4 Structure for server address
-    sockaddr_in serverAddr;
-    memset(&serverAddr, 0, sizeof(serverAddr));
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_addr.s_addr = INADDR_ANY; // 0.0.0.0 - listens(bind) on all available interfaces
-    serverAddr.sin_port = htons(_port); // Converts port number to network byte order
-
-    if (bind(_serverSocket, (struct sockaddr *)&serverAddr, sizeof(serverAddr)) < 0) { // Binds socket to the specified port on the local machine
-        close(_serverSocket);
-        throw std::runtime_error("Bind failed - port may already be in use");
-    }
+    // Reactor threads must not receive SIGINT, the main thread handles shutdown
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+    for (size_t i = 0; i < _reactors.size(); ++i)
+        _reactors[i]->start();
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
 
-    if (listen(_serverSocket, 10) < 0) { // Prepares it to listen for incoming connections
-        close(_serverSocket);
-        throw std::runtime_error("Listen failed");
-    }
+    runCore();
+}
 
-    pollfd pfd;
-    pfd.fd = _serverSocket;
-    pfd.events = POLLIN;
-    pfd.revents = 0;
-    _pollFds.push_back(pfd);
+void Server::requestStop() // async-signal-safe: sets a flag and pokes every loop awake
+{
+    _stopRequested = 1;
+    for (size_t i = 0; i < _reactors.size(); ++i)
+        _reactors[i]->wake();
+    _coreInbox.wake();
+}
 
-    std::cout << " Server is up and running on port " << _port << std::endl;
+bool Server::isStopping() const
+{
+    return _stopRequested != 0;
 }
 
-void Server::run() {
-    while (true) {
-        int ret = poll(&_pollFds[0], _pollFds.size(), -1); // Waits for events on the monitored file descriptors
-        if (ret < 0)
+void Server::runCore() // threaded mode: executes the commands forwarded by every reactor, in arrival order
+{
+    pollfd wakePoll;
+    wakePoll.fd = _coreInbox.getWakeFd();
+    wakePoll.events = POLLIN;
+    wakePoll.revents = 0;
+
+    while (!_stopRequested) {
+        if (poll(&wakePoll, 1, -1) < 0 && errno != EINTR)
             throw std::runtime_error("Poll failed");
 
-        for (size_t i = 0; i < _pollFds.size(); ++i) // Iterates through all monitored file descriptors
-        {
-            if (_pollFds[i].revents & POLLIN) // Checks if there's data to read
-            {
-                if (_pollFds[i].fd == _serverSocket) // New incoming connection
-                {
-                    acceptNewConnection();
-                }
-                else // Data from existing client
-                {
-                    handleClientData(_pollFds[i].fd);
-                }
+        _coreInbox.take(_coreBatch);
+        for (size_t i = 0; i < _coreBatch.size(); ++i) {
+            CoreEvent& event = _coreBatch[i];
+            switch (event.type) {
+                case CoreEvent::CONNECT:
+                    clientConnected(event.client);
+                    break;
+                case CoreEvent::LINE:
+                    clientCommand(*event.client, event);
+                    break;
+                case CoreEvent::DISCONNECT:
+                    clientDisconnected(event.client);
+                    // Ordered after every delivery already queued for it, so the reactor frees it last
+                    _outboxes[event.client->getReactor()->getId()].push_back(ReactorMessage(ReactorMessage::RELEASE, event.client));
+                    break;
             }
         }
+        _coreBatch.clear();
+        _replyArena.reset();
+
+        publishOutboxes();
+    }
+}
+
+void Server::publishOutboxes() // one mailbox post (and at most one wakeup) per reactor per core iteration
+{
+    for (size_t i = 0; i < _outboxes.size(); ++i)
+        _reactors[i]->post(_outboxes[i]);
+}
+
+void Server::postEvents(std::vector<CoreEvent>& batch) // called from reactor threads
+{
+    _coreInbox.post(batch);
+}
+
+void Server::clientConnected(Client* client)
+{
+    size_t fd = client->getSocketFd();
+    if (fd >= _clients.size())
+        _clients.resize(fd + 1, NULL);
+    _clients[fd] = client;
+}
+
+void Server::clientLine(Client& client, const char* line, size_t length) // executes one complete command line, straight from the receive buffer
+{
+    if (Log::shouldLog(LOG_TRACE, LOG_COMMAND)) {
+        const std::string& nick = client.getNickname();
+        LogLine(LOG_TRACE, LOG_COMMAND) << "Parsing command from client " << client.getSocketFd() << " (" << (nick.empty() ? "(unknown)" : nick.c_str()) << "): "
+                                        << std::string(line, length);
+    }
+
+    Command::executeCommand(line, length, client, *this);
+}
+
+void Server::clientCommand(Client& client, const CoreEvent& event) // threaded mode: runs a command its reactor already parsed
+{
+    if (Log::shouldLog(LOG_TRACE, LOG_COMMAND)) {
+        const std::string& nick = client.getNickname();
+        LogLine(LOG_TRACE, LOG_COMMAND) << "Running command from client " << client.getSocketFd() << " (" << (nick.empty() ? "(unknown)" : nick.c_str()) << "): "
+                                        << std::string(event.line.data(), event.line.length());
     }
+
+    Command::runCommand(event.message, event.spec, event.line.length(), client, *this);
 }
 
-void Server::acceptNewConnection() //accepting new client connections
+void Server::sendToClient(Client& client, const std::string& message) // queues a reply, the event loop writes it once the socket is writable
 {
-    sockaddr_in clientAddr;
-    socklen_t len = sizeof(clientAddr);
-    int clientFd = accept(_serverSocket, (struct sockaddr *)&clientAddr, &len);
-    if (clientFd < 0)
+    sendToClient(client, MessageBuffer(message));
+}
+
+void Server::sendToClient(Client& client, const MessageBuffer& message) // hands the reply to the reactor owning the client's socket
+{
+    if (message.empty())
         return;
+    Reactor* reactor = client.getReactor();
+    if (!_threaded)
+        reactor->queueMessage(client, message);
+    else
+        _outboxes[reactor->getId()].push_back(ReactorMessage(ReactorMessage::DELIVER, &client, message));
+}
 
-    fcntl(clientFd, F_SETFL, O_NONBLOCK);
-
-    pollfd clientPoll;
-    clientPoll.fd = clientFd;
-    clientPoll.events = POLLIN;
-    clientPoll.revents = 0;
-    _pollFds.push_back(clientPoll);
-
-    std::string ip = inet_ntoa(clientAddr.sin_addr); // converts the client's IP address to a human-readable string
-    _clients[clientFd] = new Client(clientFd, ip);
-
-    std::cout << "New client connected: " << clientFd << " (IP: " << ip << ")\n";
-}
-
-void Server::handleClientData(int clientFd) //processes data received from a client
-{
-    char buffer[1024];
-    memset(buffer, 0, sizeof(buffer));
-    ssize_t bytes = recv(clientFd, buffer, sizeof(buffer), 0); // Receives data from the client
-
-    if (bytes <= 0) {
-        std::cout << "Client disconnected: " << clientFd << "\n";
-        
-        Client* client = _clients[clientFd];
-        std::string nick = client->getNickname();
-        
-        // Remove client from all channels and handle operator-less channels
-        std::vector<std::string> channelsToDelete;
-        for (std::map<std::string, Channel*>::iterator it = _channels.begin(); it != _channels.end(); ++it) {
-            Channel* channel = it->second;
-            if (channel->hasClient(nick)) {
-                bool wasOperator = channel->isOperator(nick);
-                
-                // Notify other clients in the channel about the quit
-                std::string quitMsg = ":" + nick + " QUIT :Client disconnected\r\n";
-                for (std::set<Client*>::iterator clientIt = channel->getClients().begin(); 
-                     clientIt != channel->getClients().end(); ++clientIt) {
-                    if ((*clientIt)->getSocketFd() != clientFd) {
-                        send((*clientIt)->getSocketFd(), quitMsg.c_str(), quitMsg.length(), 0);
-                    }
-                }
-                
-                // Remove client from channel
-                channel->removeClient(nick);
-                
-                // Check if channel should be deleted
-                if (channel->getClients().empty()) {
-                    // Channel is now empty, delete it
-                    channelsToDelete.push_back(it->first);
-                } else if (wasOperator) {
-                    // Check if there are any operators left
-                    bool hasOperator = false;
-                    for (std::set<Client*>::iterator clientIt = channel->getClients().begin(); 
-                         clientIt != channel->getClients().end(); ++clientIt) {
-                        if (channel->isOperator(*clientIt)) {
-                            hasOperator = true;
-                            break;
-                        }
-                    }
-                    
-                    // If no operators left, delete channel and notify all clients
-                    if (!hasOperator) {
-                        std::string deleteMsg = ":ircserv NOTICE " + channel->getName() + " :Channel closing - no operators remaining\r\n";
-                        for (std::set<Client*>::iterator clientIt = channel->getClients().begin(); 
-                             clientIt != channel->getClients().end(); ++clientIt) {
-                            send((*clientIt)->getSocketFd(), deleteMsg.c_str(), deleteMsg.length(), 0);
-                        }
-                        channelsToDelete.push_back(it->first);
-                    }
-                }
-            }
-        }
-        
-        // Delete marked channels
-        for (size_t i = 0; i < channelsToDelete.size(); ++i) {
-            delete _channels[channelsToDelete[i]];
-            _channels.erase(channelsToDelete[i]);
-            std::cout << "Channel " << channelsToDelete[i] << " deleted (no operators)\n";
+void Server::clientRegistered(Client& client) // stops the owning reactor's registration timeout
+{
+    Reactor* reactor = client.getReactor();
+    if (!_threaded)
+        reactor->clientRegistered(&client);
+    else
+        _outboxes[reactor->getId()].push_back(ReactorMessage(ReactorMessage::REGISTERED, &client));
+}
+
+void Server::broadcast(const Channel& channel, const std::string& message, const Client* except) // serializes once, every member queues a handle to the same bytes
+{
+    broadcast(channel, MessageBuffer(message), except);
+}
+
+void Server::broadcast(const Channel& channel, const MessageBuffer& shared, const Client* except)
+{
+    const std::vector<ChannelMember>& members = channel.getMembers();
+    size_t recipients = 0;
+    for (size_t i = 0; i < members.size(); ++i) {
+        if (members[i].client != except) {
+            sendToClient(*members[i].client, shared);
+            ++recipients;
         }
-        
-        // Cleanup nickname if set
-        if (!nick.empty())
-            manageNickname(nick, NULL, UNREGISTER);
+    }
+    _metrics.fanout.record(recipients);
+}
+
+void Server::clientDisconnected(Client* client) // removes a client from every channel and the nickname registry
+{
+    int clientFd = client->getSocketFd();
+    if (Log::shouldLog(LOG_INFO, LOG_CONNECTION))
+        LogLine(LOG_INFO, LOG_CONNECTION) << "Client disconnected: " << clientFd;
     
-        // Close socket
-        close(clientFd);
+    std::string nick = client->getNickname();
+    const std::string& prefix = client->getPrefix();
     
-        // Remove from poll list
-        for (size_t i = 0; i < _pollFds.size(); ++i) {
-            if (_pollFds[i].fd == clientFd) {
-                _pollFds.erase(_pollFds.begin() + i);
-                break;
+    // Only the channels this client joined are touched, and each peer hears the QUIT once
+    // however many channels it shares with the client
+    std::vector<Channel*> joined; // Copy: removeClient() edits the client's links
+    std::set<Client*> peers;
+    for (size_t c = 0; c < client->getChannels().size(); ++c) {
+        joined.push_back(client->getChannels()[c].channel);
+        const std::vector<ChannelMember>& members = joined.back()->getMembers();
+        for (size_t i = 0; i < members.size(); ++i)
+            peers.insert(members[i].client);
+    }
+    peers.erase(client);
+    if (!peers.empty()) {
+        Reply quit(_replyArena);
+        quit << prefix << " QUIT :" << client->getQuitReason() << "\r\n";
+        MessageBuffer quitMsg = quit.message();
+        for (std::set<Client*>::iterator it = peers.begin(); it != peers.end(); ++it)
+            sendToClient(**it, quitMsg);
+        _metrics.fanout.record(peers.size());
+    }
+
+    // Pending invitations go too: the next connection may get this Client's memory and must not inherit them
+    std::vector<Channel*> invitations = client->getInvitations(); // Copy: removeInvitation() edits the client's list
+    for (size_t i = 0; i < invitations.size(); ++i)
+        invitations[i]->removeInvitation(client);
+
+    // Remove client from its channels and handle operator-less channels
+    std::vector<std::string> channelsToDelete;
+    for (size_t c = 0; c < joined.size(); ++c) {
+        Channel* channel = joined[c];
+        bool wasOperator = channel->isOperator(client);
+        channel->removeClient(client);
+
+        if (channel->getMemberCount() == 0) {
+            // Channel is now empty, delete it
+            channelsToDelete.push_back(channel->getName());
+        } else if (wasOperator) {
+            // If no operators left, delete channel and notify all clients
+            if (!channel->hasOperators()) {
+                std::string deleteMsg = ":ircserv NOTICE " + channel->getName() + " :Channel closing - no operators remaining\r\n";
+                broadcast(*channel, deleteMsg);
+                channelsToDelete.push_back(channel->getName());
             }
         }
-    
-        // Delete client
-        delete client;
-        _clients.erase(clientFd);
-        return;
     }
     
-
-    Client* client = _clients[clientFd];
-    client->appendToBuffer(std::string(buffer, bytes)); // Append received data to client's buffer
-
-    std::string& fullBuffer = client->getBuffer(); // Reference to client's buffer
-    size_t pos;
-    while ((pos = fullBuffer.find("\n")) != std::string::npos) // Process complete commands (terminated by newline)
-    {
-        std::string commandLine = fullBuffer.substr(0, pos);
-        if (!commandLine.empty() && commandLine[commandLine.length() - 1] == '\r')
-            commandLine = commandLine.substr(0, commandLine.length() - 1);
-        fullBuffer.erase(0, pos + 1);
-    
-        std::string displayName = client->getNickname().empty() ? "(unknown)" : client->getNickname();
-        std::cout << "Parsing command from client " << clientFd << " (" << displayName << "): " << commandLine << "\n";
-        
-        Command::executeCommand(commandLine, *client, *this);
+    // Delete marked channels
+    for (size_t i = 0; i < channelsToDelete.size(); ++i) {
+        const Symbol* name = _channelNames.find(channelsToDelete[i]);
+        delete _channels[name->id];
+        _channels[name->id] = NULL;
+        _channelNames.remove(name);
+        if (Log::shouldLog(LOG_INFO, LOG_CHANNEL))
+            LogLine(LOG_INFO, LOG_CHANNEL) << "Channel " << channelsToDelete[i] << " deleted (no operators)";
     }
     
+    // Cleanup nickname if set
+    if (!nick.empty())
+        manageNickname(nick, client, UNREGISTER);
+
+    _clients[clientFd] = NULL;
 }
 
 bool Server::manageNickname(const std::string &nickname, Client* client, NicknameOperation op) {
     switch (op) {
         case CHECK:
-            return _registeredNicknames.find(nickname) != _registeredNicknames.end();
-        case REGISTER:
-            _registeredNicknames[nickname] = client;
+            return _nicknames.find(nickname) != NULL;
+        case REGISTER: {
+            const Symbol* symbol = _nicknames.insert(nickname, client);
+            if (!symbol)
+                return false;
+            client->setNickname(symbol);
             return true;
+        }
         case UNREGISTER:
-            _registeredNicknames.erase(nickname);
+            if (client)
+                client->setNickname(NULL);
+            return _nicknames.erase(nickname);
+        case RENAME:
+            if (!client->getNicknameSymbol())
+                return manageNickname(nickname, client, REGISTER);
+            if (!_nicknames.rename(client->getNicknameSymbol(), nickname)) // The client's Symbol now reads the new nick
+                return false;
+            for (size_t c = 0; c < client->getChannels().size(); ++c)
+                client->getChannels()[c].channel->invalidateNames();
             return true;
         default:
             return false;
@@ -242,22 +320,28 @@ bool Server::manageNickname(const std::string &nickname, Client* client, Nicknam
 // Usage:
 // if (server.manageNickname("nick", nullptr, CHECK)) { ... }
 // server.manageNickname("nick", client, REGISTER);
-// server.manageNickname("nick", nullptr, UNREGISTER);
+// server.manageNickname("nick", client, UNREGISTER);
+// if (!server.manageNickname("newnick", client, RENAME)) { ... taken ... }
 
 
 Channel* Server::createOrGetChannel(const std::string& channelName)
 {
-    if (_channels.find(channelName) == _channels.end())
-        _channels[channelName] = new Channel(channelName);
-        
-    return _channels[channelName];
+    const Symbol* name = _channelNames.find(channelName);
+    if (name)
+        return _channels[name->id];
+
+    Channel* channel = new Channel(channelName);
+    name = _channelNames.add(channelName);
+    if (_channels.size() < _channelNames.idLimit())
+        _channels.resize(_channelNames.idLimit(), NULL);
+    _channels[name->id] = channel;
+    return channel;
 }
 
 Channel* Server::getChannel(const std::string& channelName)
 {
-    if (_channels.find(channelName) != _channels.end())
-        return _channels[channelName];
-    return NULL;
+    const Symbol* name = _channelNames.find(channelName);
+    return name ? _channels[name->id] : NULL;
 }
 
 const std::string& Server::getPassword() const
@@ -265,19 +349,88 @@ const std::string& Server::getPassword() const
     return _password;
 }
 
-const std::map<int, Client*>& Server::getClients() const
+const std::vector<Client*>& Server::getClients() const
 {
     return _clients;
 }
 
-Client* Server::getClientByNickname(const std::string& nickname) const
+FlushStats Server::getFlushStats() const // summed over every reactor
+{
+    FlushStats total;
+    for (size_t i = 0; i < _reactors.size(); ++i) {
+        const FlushStats& stats = _reactors[i]->getFlushStats();
+        total.writeCalls += stats.writeCalls;
+        total.messagesWritten += stats.messagesWritten;
+        total.bytesWritten += stats.bytesWritten;
+        total.sendQEvictions += stats.sendQEvictions;
+    }
+    return total;
+}
+
+FloodStats Server::getFloodStats() const // lines summed, delay maximum over every reactor
 {
-    for (std::map<int, Client*>::const_iterator it = _clients.begin(); it != _clients.end(); ++it)
-    {
-        if (it->second->getNickname() == nickname)
-            return it->second;
+    FloodStats total;
+    for (size_t i = 0; i < _reactors.size(); ++i) {
+        const FloodStats& stats = _reactors[i]->getFloodStats();
+        total.throttledLines += stats.throttledLines;
+        if (stats.maxDelayMs > total.maxDelayMs)
+            total.maxDelayMs = stats.maxDelayMs;
     }
-    return NULL;
+    return total;
+}
+
+CoreMetrics& Server::getMetrics()
+{
+    return _metrics;
+}
+
+Arena& Server::getReplyArena()
+{
+    return _replyArena;
+}
+
+void Server::resetReplyArena() // every reply built since the last reset has been copied into its MessageBuffer
+{
+    _replyArena.reset();
+}
+
+LoopMetrics Server::getLoopMetrics() const // summed over every reactor
+{
+    LoopMetrics total;
+    for (size_t i = 0; i < _reactors.size(); ++i)
+        total.merge(_reactors[i]->getLoopMetrics());
+    return total;
+}
+
+Client* Server::connectLoopback(LoopbackPeer* peer)
+{
+    Reactor* reactor = _reactors[0];
+    return reactor->attach(new LoopbackTransport(reactor->reserveLoopbackId(), peer), "loopback");
+}
+
+void Server::runLoopback(const std::vector<Client*>& ready)
+{
+    _reactors[0]->runLoopback(ready);
+}
+
+void Server::advanceLoopbackClock(unsigned long ms)
+{
+    _reactors[0]->advanceClock(ms);
+}
+
+TraceWriter* Server::getTrace() const
+{
+    return _trace;
+}
+
+unsigned long Server::nextConnectionId()
+{
+    return __sync_add_and_fetch(&_nextConnectionId, 1);
+}
+
+Client* Server::getClientByNickname(const std::string& nickname) const
+{
+    return _nicknames.find(nickname);
 }
 
 /*
@@ -294,6 +447,6 @@ Client Decides to Connect
 
 Server Accepts Connection
      Creates new socket specifically for this client
-     Adds to poll() monitoring list
+     Adds to the reactor's poll()/epoll monitoring list
      Creates Client object to track this user
 */
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "../includes/SymbolTable.hpp"
+
+static const size_t INITIAL_SLOTS = 64;
+static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+const unsigned int SymbolTable::NO_SYMBOL;
+
+Symbol::Symbol() : id(SymbolTable::NO_SYMBOL), hash(0)
+{
+}
+
+SymbolTable::SymbolTable() : _symbols(1, static_cast<Symbol*>(NULL)), _slots(INITIAL_SLOTS, static_cast<Symbol*>(NULL)), _count(0)
+{
+}
+
+SymbolTable::~SymbolTable()
+{
+    for (size_t i = 0; i < _symbols.size(); ++i)
+        delete _symbols[i];
+}
+
+// RFC 1459 casemapping: A-Z[\]^ fold to a-z{|}~
+char SymbolTable::fold(char c)
+{
+    if (c >= 'A' && c <= '^')
+        return c + ('a' - 'A');
+    return c;
+}
+
+// FNV-1a over the folded characters
+unsigned int SymbolTable::hash(const std::string& name)
+{
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < name.length(); ++i) {
+        h ^= static_cast<unsigned char>(fold(name[i]));
+        h *= 16777619u;
+    }
+    return h;
+}
+
+bool SymbolTable::equals(const std::string& a, const std::string& b)
+{
+    if (a.length() != b.length())
+        return false;
+    for (size_t i = 0; i < a.length(); ++i) {
+        if (fold(a[i]) != fold(b[i]))
+            return false;
+    }
+    return true;
+}
+
+size_t SymbolTable::findSlot(const std::string& name, unsigned int h) const
+{
+    size_t mask = _slots.size() - 1;
+    for (size_t i = h & mask; _slots[i]; i = (i + 1) & mask) {
+        if (_slots[i]->hash == h && equals(_slots[i]->name, name))
+            return i;
+    }
+    return NOT_FOUND;
+}
+
+void SymbolTable::insertSlot(Symbol* symbol)
+{
+    size_t mask = _slots.size() - 1;
+    size_t i = symbol->hash & mask;
+    while (_slots[i])
+        i = (i + 1) & mask;
+    _slots[i] = symbol;
+}
+
+// Backward-shift deletion: pull later entries of the probe chain into the hole
+// unless their home slot lies cyclically after it
+void SymbolTable::removeSlot(size_t index)
+{
+    size_t mask = _slots.size() - 1;
+    size_t hole = index;
+    for (size_t i = (hole + 1) & mask; _slots[i]; i = (i + 1) & mask) {
+        size_t home = _slots[i]->hash & mask;
+        bool stays = (hole <= i) ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (stays)
+            continue;
+        _slots[hole] = _slots[i];
+        hole = i;
+    }
+    _slots[hole] = NULL;
+}
+
+// Keeps the load factor at or below one half
+void SymbolTable::grow()
+{
+    std::vector<Symbol*> old(_slots.size() * 2, static_cast<Symbol*>(NULL));
+    old.swap(_slots);
+    for (size_t i = 0; i < old.size(); ++i) {
+        if (old[i])
+            insertSlot(old[i]);
+    }
+}
+
+const Symbol* SymbolTable::find(const std::string& name) const
+{
+    size_t i = findSlot(name, hash(name));
+    return (i == NOT_FOUND) ? NULL : _slots[i];
+}
+
+const Symbol* SymbolTable::add(const std::string& name)
+{
+    unsigned int h = hash(name);
+    if (findSlot(name, h) != NOT_FOUND)
+        return NULL;
+    if ((_count + 1) * 2 > _slots.size())
+        grow();
+
+    Symbol* symbol;
+    if (_freeIds.empty()) {
+        symbol = new Symbol();
+        symbol->id = static_cast<unsigned int>(_symbols.size());
+        _symbols.push_back(symbol);
+    } else {
+        symbol = _symbols[_freeIds.back()];
+        _freeIds.pop_back();
+    }
+    symbol->name = name;
+    symbol->prefix = ":" + name;
+    symbol->hash = h;
+    insertSlot(symbol);
+    ++_count;
+    return symbol;
+}
+
+// A change of case only ("nick" → "Nick") keeps the slot and just respells the name
+bool SymbolTable::rename(const Symbol* symbol, const std::string& name)
+{
+    Symbol* entry = _symbols[symbol->id];
+    unsigned int h = hash(name);
+    size_t taken = findSlot(name, h);
+    if (taken != NOT_FOUND && _slots[taken] != entry)
+        return false;
+    if (taken == NOT_FOUND) {
+        removeSlot(findSlot(entry->name, entry->hash));
+        entry->hash = h;
+    }
+    entry->name = name;
+    entry->prefix = ":" + name;
+    if (taken == NOT_FOUND)
+        insertSlot(entry);
+    return true;
+}
+
+void SymbolTable::remove(const Symbol* symbol)
+{
+    Symbol* entry = _symbols[symbol->id];
+    removeSlot(findSlot(entry->name, entry->hash));
+    entry->name.clear();
+    entry->prefix.clear();
+    _freeIds.push_back(entry->id);
+    --_count;
+}
+
+size_t SymbolTable::size() const
+{
+    return _count;
+}
+
+size_t SymbolTable::idLimit() const
+{
+    return _symbols.size();
+}
@@ -0,0 +1,119 @@
+#include "../includes/TimerWheel.hpp"
+
+Timer::Timer() : prev(NULL), next(NULL), expires(0), client(NULL), kind(0)
+{
+}
+
+bool Timer::isArmed() const
+{
+    return next != NULL;
+}
+
+TimerWheel::TimerWheel(unsigned long nowMs, unsigned long tickMs) : _tickMs(tickMs), _current(nowMs / tickMs), _count(0)
+{
+    for (size_t level = 0; level < LEVELS; ++level) {
+        for (size_t slot = 0; slot < SLOTS; ++slot)
+            _slots[level][slot].prev = _slots[level][slot].next = &_slots[level][slot];
+    }
+}
+
+// Picks the lowest level whose span reaches the deadline. A slot on level L is cascaded
+// when the wheel reaches the start of its range, before any of its timers is due.
+void TimerWheel::place(Timer& timer)
+{
+    unsigned long delta = timer.expires - _current;
+    size_t level = 0;
+    while (level < LEVELS - 1 && delta >= (1UL << (LEVEL_BITS * (level + 1))))
+        ++level;
+    if (delta >= (1UL << (LEVEL_BITS * LEVELS))) // Beyond the wheel's span (19 days at 100 ms ticks): fires at its horizon
+        timer.expires = _current + (1UL << (LEVEL_BITS * LEVELS)) - 1;
+
+    Timer& head = _slots[level][(timer.expires >> (LEVEL_BITS * level)) & (SLOTS - 1)];
+    timer.prev = head.prev;
+    timer.next = &head;
+    head.prev->next = &timer;
+    head.prev = &timer;
+}
+
+void TimerWheel::cascade(size_t level, size_t slot)
+{
+    Timer& head = _slots[level][slot];
+    Timer* timer = head.next;
+    head.prev = head.next = &head;
+    while (timer != &head) {
+        Timer* following = timer->next;
+        place(*timer);
+        timer = following;
+    }
+}
+
+void TimerWheel::schedule(Timer& timer, unsigned long whenMs)
+{
+    if (timer.isArmed())
+        cancel(timer);
+
+    unsigned long tick = (whenMs + _tickMs - 1) / _tickMs; // Round up: never fire early
+    timer.expires = (tick > _current) ? tick : _current + 1;
+    place(timer);
+    ++_count;
+}
+
+void TimerWheel::cancel(Timer& timer)
+{
+    if (!timer.isArmed())
+        return;
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = timer.next = NULL;
+    --_count;
+}
+
+// Turns the wheel up to nowMs and appends every timer that came due, already disarmed,
+// so the caller may re-arm them
+void TimerWheel::advance(unsigned long nowMs, std::vector<Timer*>& expired)
+{
+    unsigned long target = nowMs / _tickMs;
+    if (_count == 0 && target > _current) // Nothing to cascade or fire on the way
+        _current = target;
+
+    while (_current < target) {
+        ++_current;
+        size_t slot = _current & (SLOTS - 1);
+        for (size_t level = 1; slot == 0 && level < LEVELS; ++level) {
+            slot = (_current >> (LEVEL_BITS * level)) & (SLOTS - 1);
+            cascade(level, slot);
+        }
+
+        Timer& head = _slots[0][_current & (SLOTS - 1)];
+        while (head.next != &head) {
+            Timer* timer = head.next;
+            cancel(*timer);
+            expired.push_back(timer);
+        }
+    }
+}
+
+// Exact up to the next level-1 cascade, where timers from the levels above may come due;
+// the wait never exceeds SLOTS ticks
+int TimerWheel::msUntilNext(unsigned long nowMs) const
+{
+    if (_count == 0)
+        return -1;
+
+    unsigned long due = ((_current >> LEVEL_BITS) + 1) << LEVEL_BITS;
+    for (unsigned long tick = _current + 1; tick < due; ++tick) {
+        const Timer& head = _slots[0][tick & (SLOTS - 1)];
+        if (head.next != &head) {
+            due = tick;
+            break;
+        }
+    }
+
+    unsigned long dueMs = due * _tickMs;
+    return (dueMs > nowMs) ? static_cast<int>(dueMs - nowMs) : 0;
+}
+
+size_t TimerWheel::size() const
+{
+    return _count;
+}
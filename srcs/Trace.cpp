@@ -0,0 +1,121 @@
+#include "../includes/Trace.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <strings.h> // for strncasecmp()
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+#include <unistd.h> // for write(), close()
+#include <fcntl.h> // for open()
+
+const char TraceWriter::MAGIC[8] = { 'I', 'R', 'C', 'T', 'R', 'A', 'C', 'E' };
+const unsigned char TraceWriter::VERSION;
+
+static void putVarint(std::string& out, unsigned long value)
+{
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static bool getVarint(const std::string& in, size_t& pos, unsigned long& value)
+{
+    value = 0;
+    for (unsigned int shift = 0; pos < in.size() && shift < 64; shift += 7) {
+        unsigned char byte = in[pos++];
+        value |= static_cast<unsigned long>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+TraceWriter::TraceWriter(const std::string& path, unsigned long startNs) : _startNs(startNs)
+{
+    _fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (_fd < 0)
+        throw std::runtime_error("Cannot open trace file " + path + ": " + strerror(errno));
+    pthread_mutex_init(&_mutex, NULL);
+    std::string header(MAGIC, sizeof(MAGIC));
+    header += static_cast<char>(VERSION);
+    write(header);
+}
+
+TraceWriter::~TraceWriter()
+{
+    pthread_mutex_destroy(&_mutex);
+    close(_fd);
+}
+
+unsigned long TraceWriter::getStartNs() const
+{
+    return _startNs;
+}
+
+void TraceWriter::encode(std::string& batch, TraceRecordType type, unsigned long timeUs, unsigned long connection, const char* line, size_t length)
+{
+    batch += static_cast<char>(type);
+    putVarint(batch, timeUs);
+    putVarint(batch, connection);
+    if (type != TRACE_LINE)
+        return;
+    if (length >= 5 && strncasecmp(line, "PASS ", 5) == 0) {
+        line = "PASS *";
+        length = 6;
+    }
+    putVarint(batch, length);
+    batch.append(line, length);
+}
+
+void TraceWriter::write(std::string& batch)
+{
+    pthread_mutex_lock(&_mutex);
+    const char* data = batch.data();
+    size_t left = batch.size();
+    while (left > 0) {
+        ssize_t written = ::write(_fd, data, left);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0) // Disk full or similar: the trace is cut short, the server carries on
+            break;
+        data += written;
+        left -= written;
+    }
+    pthread_mutex_unlock(&_mutex);
+    batch.clear();
+}
+
+std::vector<TraceRecord> readTrace(const std::string& path)
+{
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Cannot open trace file " + path);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (data.size() < sizeof(TraceWriter::MAGIC) + 1 || data.compare(0, sizeof(TraceWriter::MAGIC), TraceWriter::MAGIC, sizeof(TraceWriter::MAGIC)) != 0)
+        throw std::runtime_error(path + " is not a trace file");
+    if (static_cast<unsigned char>(data[sizeof(TraceWriter::MAGIC)]) != TraceWriter::VERSION)
+        throw std::runtime_error(path + " has an unsupported trace version");
+
+    std::vector<TraceRecord> records;
+    size_t pos = sizeof(TraceWriter::MAGIC) + 1;
+    while (pos < data.size()) {
+        TraceRecord record;
+        int type = static_cast<unsigned char>(data[pos++]);
+        if (type != TRACE_CONNECT && type != TRACE_LINE && type != TRACE_CLOSE)
+            throw std::runtime_error(path + ": unknown record type");
+        record.type = static_cast<TraceRecordType>(type);
+        unsigned long length = 0;
+        if (!getVarint(data, pos, record.timeUs) || !getVarint(data, pos, record.connection)
+            || (record.type == TRACE_LINE && (!getVarint(data, pos, length) || length > data.size() - pos)))
+            break; // Cut short while the server was writing it: keep what is complete
+        if (record.type == TRACE_LINE) {
+            record.line.assign(data, pos, length);
+            pos += length;
+        }
+        records.push_back(record);
+    }
+    return records;
+}
@@ -0,0 +1,164 @@
+#include "../includes/Transport.hpp"
+#include <cerrno>
+#include <cstring> // for memcpy
+#include <unistd.h> // for close()
+#include <sys/socket.h> // for recv(), send()
+
+static const unsigned long FNV_OFFSET = 14695981039346656037UL;
+static const unsigned long FNV_PRIME = 1099511628211UL;
+
+Transport::Transport(int fd) : _fd(fd) {}
+
+Transport::~Transport() {}
+
+int Transport::getFd() const
+{
+    return _fd;
+}
+
+SocketTransport::SocketTransport(int fd) : Transport(fd) {}
+
+ssize_t SocketTransport::receive(char* buffer, size_t length)
+{
+    return recv(_fd, buffer, length, 0);
+}
+
+ssize_t SocketTransport::sendv(const iovec* iov, int count)
+{
+    return writev(_fd, iov, count);
+}
+
+void SocketTransport::sendNow(const char* data, size_t length)
+{
+    send(_fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+void SocketTransport::close()
+{
+    ::close(_fd);
+}
+
+LoopbackPeer::LoopbackPeer(OutputMode mode, size_t capacity) : _readOffset(0), _hungUp(false), _reset(false), _mode(mode), _capacity(capacity), _bytesReceived(0), _hash(FNV_OFFSET), _closed(false) {}
+
+void LoopbackPeer::send(const std::string& data)
+{
+    if (_readOffset == _toServer.size()) { // All read: start over instead of growing
+        _toServer.clear();
+        _readOffset = 0;
+    }
+    _toServer += data;
+}
+
+void LoopbackPeer::hangUp()
+{
+    _hungUp = true;
+}
+
+void LoopbackPeer::reset()
+{
+    _reset = true;
+}
+
+bool LoopbackPeer::hasInput() const
+{
+    return _readOffset < _toServer.size() || _hungUp || _reset;
+}
+
+std::string LoopbackPeer::takeOutput()
+{
+    std::string output;
+    output.swap(_fromServer);
+    return output;
+}
+
+unsigned long LoopbackPeer::getBytesReceived() const
+{
+    return _bytesReceived;
+}
+
+unsigned long LoopbackPeer::getOutputHash() const
+{
+    return _hash;
+}
+
+bool LoopbackPeer::isClosed() const
+{
+    return _closed;
+}
+
+LoopbackTransport::LoopbackTransport(int id, LoopbackPeer* peer) : Transport(id), _peer(peer) {}
+
+ssize_t LoopbackTransport::receive(char* buffer, size_t length)
+{
+    if (_peer->_reset) {
+        errno = ECONNRESET;
+        return -1;
+    }
+    size_t available = _peer->_toServer.size() - _peer->_readOffset;
+    if (available == 0) {
+        if (_peer->_hungUp)
+            return 0;
+        errno = EAGAIN;
+        return -1;
+    }
+    if (length > available)
+        length = available;
+    memcpy(buffer, _peer->_toServer.data() + _peer->_readOffset, length);
+    _peer->_readOffset += length;
+    return length;
+}
+
+ssize_t LoopbackTransport::sendv(const iovec* iov, int count)
+{
+    return write(iov, count, true);
+}
+
+void LoopbackTransport::sendNow(const char* data, size_t length)
+{
+    iovec iov;
+    iov.iov_base = const_cast<char*>(data);
+    iov.iov_len = length;
+    write(&iov, 1, false);
+}
+
+ssize_t LoopbackTransport::write(const iovec* iov, int count, bool bounded)
+{
+    if (_peer->_reset) {
+        errno = EPIPE;
+        return -1;
+    }
+    size_t room = static_cast<size_t>(-1);
+    if (bounded && _peer->_capacity > 0 && _peer->_mode == LoopbackPeer::KEEP_OUTPUT) {
+        if (_peer->_fromServer.size() >= _peer->_capacity) {
+            errno = EAGAIN;
+            return -1;
+        }
+        room = _peer->_capacity - _peer->_fromServer.size();
+    }
+
+    size_t written = 0;
+    for (int i = 0; i < count && room > 0; ++i) {
+        const char* data = static_cast<const char*>(iov[i].iov_base);
+        size_t length = (iov[i].iov_len < room) ? iov[i].iov_len : room;
+        if (_peer->_mode == LoopbackPeer::KEEP_OUTPUT)
+            _peer->_fromServer.append(data, length);
+        else if (_peer->_mode == LoopbackPeer::HASH_OUTPUT) {
+            for (size_t k = 0; k < length; ++k)
+                _peer->_hash = (_peer->_hash ^ static_cast<unsigned char>(data[k])) * FNV_PRIME;
+        }
+        written += length;
+        room -= length;
+    }
+    _peer->_bytesReceived += written;
+    return written;
+}
+
+void LoopbackTransport::close()
+{
+    _peer->_closed = true;
+}
+
+bool LoopbackTransport::isReset() const
+{
+    return _peer->_reset;
+}
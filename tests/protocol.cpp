@@ -0,0 +1,429 @@
+// Protocol regression tests.
+// Each case runs the real server on the loopback backend, with in-memory clients in this
+// process, sends IRC lines and checks the replies. `make test` builds and runs every case;
+// a failure prints the case, what was expected and what the client received, and the run
+// exits non-zero.
+
+#include "../includes/Server.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// One server and the clients connected to it
+class Session
+{
+    private:
+        Server* _server;
+        std::vector<LoopbackPeer*> _peers;
+        std::vector<Client*> _clients; // Server side of _peers[i], NULL once released
+
+        Session(const Session&);
+        Session& operator=(const Session&);
+
+    public:
+        // Loopback, with the limits that depend on timing or volume off; a case turns on the one it tests
+        static ServerConfig defaults()
+        {
+            ServerConfig config;
+            config.backend = BACKEND_LOOPBACK;
+            config.flood.rate = 0;
+            config.sendQ = 0;
+            config.pingInterval = 0; // No wall-clock deadlines
+            config.registrationTimeout = 0;
+            return config;
+        }
+
+        Session(const ServerConfig& config = defaults()) : _server(new Server(0, "pw", config)) {}
+
+        ~Session()
+        {
+            delete _server; // First: closing its connections still reaches the peers
+            for (size_t i = 0; i < _peers.size(); ++i)
+                delete _peers[i];
+        }
+
+        // Connects a client that has sent nothing yet. With a capacity, replies it has not taken
+        // beyond that many bytes stay queued in the server, like behind a full socket.
+        size_t open(size_t capacity = 0)
+        {
+            _peers.push_back(new LoopbackPeer(LoopbackPeer::KEEP_OUTPUT, capacity));
+            _clients.push_back(_server->connectLoopback(_peers.back()));
+            return _peers.size() - 1;
+        }
+
+        // Connects and registers a client, its welcome lines already read
+        size_t connect(const std::string& nick, size_t capacity = 0)
+        {
+            size_t i = open(capacity);
+            send(i, "PASS pw\r\nNICK " + nick + "\r\nUSER " + nick + " 0 * :" + nick + "\r\nAUTHENTICATE\r\n");
+            return i;
+        }
+
+        // Sends lines from client i, runs the server until it is done with them, returns what i received
+        std::string send(size_t i, const std::string& lines)
+        {
+            _peers[i]->send(lines);
+            run();
+            return _peers[i]->takeOutput();
+        }
+
+        std::string output(size_t i)
+        {
+            return _peers[i]->takeOutput();
+        }
+
+        LoopbackPeer& peer(size_t i)
+        {
+            return *_peers[i];
+        }
+
+        // Moves the server's clock forward and runs an iteration, as if that much time went by
+        void elapse(unsigned long ms)
+        {
+            _server->advanceLoopbackClock(ms);
+            run();
+        }
+
+        // Client i hangs up; the server releases it
+        void quit(size_t i)
+        {
+            _peers[i]->hangUp();
+            run();
+            if (!_peers[i]->isClosed())
+                throw std::runtime_error("server kept a connection its peer hung up");
+            _clients[i] = NULL;
+        }
+
+        void run()
+        {
+            std::vector<Client*> ready;
+            for (size_t i = 0; i < _clients.size(); ++i) {
+                if (_clients[i] && !_peers[i]->isClosed())
+                    ready.push_back(_clients[i]);
+            }
+            _server->runLoopback(ready);
+            for (size_t i = 0; i < _clients.size(); ++i) {
+                if (_clients[i] && _peers[i]->isClosed())
+                    _clients[i] = NULL;
+            }
+        }
+};
+
+static int g_failures = 0;
+
+static void expect(const char* test, const std::string& received, const std::string& wanted)
+{
+    if (received.find(wanted) != std::string::npos)
+        return;
+    std::cout << "FAIL " << test << ": expected \"" << wanted << "\" in:\n" << received << "\n";
+    ++g_failures;
+}
+
+static void expectTrue(const char* test, bool condition, const std::string& what)
+{
+    if (condition)
+        return;
+    std::cout << "FAIL " << test << ": expected " << what << "\n";
+    ++g_failures;
+}
+
+static void expectNot(const char* test, const std::string& received, const std::string& unwanted)
+{
+    if (received.find(unwanted) == std::string::npos)
+        return;
+    std::cout << "FAIL " << test << ": unexpected \"" << unwanted << "\" in:\n" << received << "\n";
+    ++g_failures;
+}
+
+// Nicknames compare under RFC 1459 casemapping: letters fold to lower case, and [ ] \ fold
+// to { } |. Whichever spelling comes second is taken, and any spelling reaches its owner.
+static void nickCasemapping()
+{
+    const char* test = "nickCasemapping";
+    Session session;
+    size_t nick = session.connect("nick");
+    size_t second = session.open();
+    expect(test, session.send(second, "PASS pw\r\nNICK NICK\r\n"), ":ircserv 433 * NICK :Nickname is already in use");
+
+    size_t brackets = session.connect("a[b]\\c");
+    expect(test, session.send(second, "NICK A{B}|C\r\n"), ":ircserv 433 * A{B}|C :Nickname is already in use");
+
+    size_t sender = session.connect("sender");
+    std::string reply = session.send(sender, "PRIVMSG A{B}|C :hi\r\nPRIVMSG NiCk :hey\r\n");
+    expectNot(test, reply, " 401 ");
+    expect(test, session.output(brackets), ":sender PRIVMSG A{B}|C :hi");
+    expect(test, session.output(nick), ":sender PRIVMSG NiCk :hey");
+}
+
+// An invitation belongs to the connection it was sent to. A later connection that reuses the
+// invitee's Client slot, or its nick, must not be able to use it.
+static void inviteEndsWithConnection()
+{
+    const char* test = "inviteEndsWithConnection";
+    Session session;
+    size_t alice = session.connect("alice");
+    size_t bob = session.connect("bob");
+    session.send(alice, "JOIN #vip\r\nMODE #vip +i\r\n");
+    session.send(alice, "INVITE bob #vip\r\n");
+    expect(test, session.output(bob), ":alice INVITE bob :#vip");
+    session.quit(bob);
+
+    size_t mallory = session.connect("mallory");
+    std::string reply = session.send(mallory, "JOIN #vip\r\n");
+    expect(test, reply, ":ircserv 473 mallory #vip");
+    expectNot(test, reply, "JOIN #vip");
+
+    size_t bobAgain = session.connect("bob");
+    expect(test, session.send(bobAgain, "JOIN #vip\r\n"), ":ircserv 473 bob #vip");
+}
+
+// The invitee still gets in while connected
+static void inviteAdmits()
+{
+    const char* test = "inviteAdmits";
+    Session session;
+    size_t alice = session.connect("alice");
+    size_t bob = session.connect("bob");
+    session.send(alice, "JOIN #vip\r\nMODE #vip +i\r\nINVITE bob #vip\r\n");
+    expect(test, session.send(bob, "JOIN #vip\r\n"), ":bob JOIN #vip");
+}
+
+// A client that leaves shares two channels with a peer: the peer hears its QUIT once, and
+// both channels forget it
+static void quitOncePerPeer()
+{
+    const char* test = "quitOncePerPeer";
+    Session session;
+    size_t alice = session.connect("alice");
+    size_t bob = session.connect("bob");
+    session.send(alice, "JOIN #one\r\nJOIN #two\r\n");
+    session.send(bob, "JOIN #one\r\nJOIN #two\r\n");
+    session.output(alice);
+
+    session.quit(bob);
+    std::string seen = session.output(alice);
+    std::string quit = ":bob QUIT :";
+    size_t first = seen.find(quit);
+    expect(test, seen, quit);
+    if (first != std::string::npos)
+        expectNot(test, seen.substr(first + quit.length()), quit);
+
+    std::string names = session.send(alice, "NAMES #one,#two\r\n");
+    expect(test, names, ":ircserv 353 alice = #one :@alice\r\n");
+    expect(test, names, ":ircserv 353 alice = #two :@alice\r\n");
+}
+
+// Every 353 line of a channel with the longest allowed name fits 512 bytes, and a longer
+// name is refused
+static void namesFitLine()
+{
+    const char* test = "namesFitLine";
+    Session session;
+    std::string longest = "#" + std::string(Channel::NAME_MAX_LENGTH - 1, 'c');
+    std::string replies;
+    for (int n = 0; n < 60; ++n) {
+        std::string nick = "member";
+        nick += static_cast<char>('a' + n / 26);
+        nick += static_cast<char>('a' + n % 26);
+        replies = session.send(session.connect(nick), "JOIN " + longest + "\r\n");
+    }
+    expect(test, replies, ":ircserv 366 memberch " + longest);
+    size_t lines = 0;
+    for (size_t start = 0; start < replies.size(); ) {
+        size_t end = replies.find("\r\n", start);
+        if (end == std::string::npos)
+            break;
+        if (end + 2 - start > 512)
+            expect(test, replies.substr(start, end - start), "a line of at most 512 bytes");
+        if (replies.compare(start, 13, ":ircserv 353 ") == 0)
+            ++lines;
+        start = end + 2;
+    }
+    if (lines < 2)
+        expect(test, replies, "names split over several 353 lines");
+
+    size_t late = session.connect("late");
+    std::string tooLong = longest + "c";
+    expect(test, session.send(late, "JOIN " + tooLong + "\r\n"), ":ircserv 403 late " + tooLong + " :No such channel");
+}
+
+// NAMES spells an existing channel as it was created in both the 353 and the 366, whatever
+// the case the request used; an unknown channel's 366 echoes the request
+static void namesUseChannelSpelling()
+{
+    const char* test = "namesUseChannelSpelling";
+    Session session;
+    size_t alice = session.connect("alice");
+    session.send(alice, "JOIN #general\r\n");
+    std::string reply = session.send(alice, "NAMES #GENERAL,#NotHere\r\n");
+    expect(test, reply, ":ircserv 353 alice = #general :@alice\r\n:ircserv 366 alice #general :End of /NAMES list");
+    expectNot(test, reply, "#GENERAL");
+    expect(test, reply, ":ircserv 366 alice #NotHere :End of /NAMES list");
+}
+
+// MODE knows i, t, k, l and o only, and a channel takes messages from its members
+static void channelModes()
+{
+    const char* test = "channelModes";
+    Session session;
+    size_t alice = session.connect("alice");
+    size_t bob = session.connect("bob");
+    session.send(alice, "JOIN #general\r\n");
+    expect(test, session.send(alice, "MODE #general +m\r\n"), ":ircserv 472 m :is unknown mode char");
+    expect(test, session.send(alice, "MODE #general +v alice\r\n"), ":ircserv 472 v :is unknown mode char");
+    expect(test, session.send(alice, "MODE #general\r\n"), ":ircserv 324 alice #general +\r\n");
+
+    expect(test, session.send(bob, "PRIVMSG #general :hi\r\n"), ":ircserv 404 bob #general :Cannot send to channel");
+    expectNot(test, session.output(alice), "PRIVMSG");
+    session.send(bob, "JOIN #general\r\n");
+    session.output(alice);
+    session.send(bob, "PRIVMSG #general :hi\r\n");
+    expect(test, session.output(alice), ":bob PRIVMSG #general :hi");
+}
+
+// A member that stops reading in a busy channel goes over its SendQ: it is told why and closed,
+// and the rest of the channel sees it quit
+static void sendQEviction()
+{
+    const char* test = "sendQEviction";
+    ServerConfig config = Session::defaults();
+    config.sendQ = 2048;
+    Session session(config);
+    size_t alice = session.connect("alice");
+    size_t bob = session.connect("bob");
+    size_t slow = session.connect("slow", 1024);
+    session.send(alice, "JOIN #busy\r\n");
+    session.send(bob, "JOIN #busy\r\n");
+    session.send(slow, "JOIN #busy\r\n");
+    session.output(alice);
+    session.output(bob);
+
+    std::string burst;
+    for (int n = 0; n < 40; ++n)
+        burst += "PRIVMSG #busy :" + std::string(100, 'x') + "\r\n";
+    session.send(alice, burst);
+    expectTrue(test, session.peer(slow).isClosed(), "the slow member to be disconnected");
+    expect(test, session.output(slow), "ERROR :Closing Link: loopback (Max SendQ exceeded)\r\n");
+    expect(test, session.output(bob), ":slow QUIT :Max SendQ exceeded");
+    expectTrue(test, !session.peer(bob).isClosed(), "the members that keep up to stay connected");
+}
+
+// A connection that does not authenticate in time is dropped; one that did is left alone
+static void registrationTimeout()
+{
+    const char* test = "registrationTimeout";
+    ServerConfig config = Session::defaults();
+    config.registrationTimeout = 5;
+    Session session(config);
+    size_t alice = session.connect("alice");
+    size_t early = session.open();
+    session.send(early, "PASS pw\r\nNICK early\r\n");
+
+    session.elapse(4000);
+    expectTrue(test, !session.peer(early).isClosed(), "the connection to get its whole registration timeout");
+    session.elapse(1200);
+    expectTrue(test, session.peer(early).isClosed(), "the unregistered connection to be dropped");
+    expect(test, session.output(early), "ERROR :Closing Link: loopback (Registration timed out)\r\n");
+    expectTrue(test, !session.peer(alice).isClosed(), "the registered client to stay connected");
+}
+
+// A quiet client is PINGed after the interval; one that answers stays, one that does not is
+// dropped once the timeout runs out
+static void pingTimeout()
+{
+    const char* test = "pingTimeout";
+    ServerConfig config = Session::defaults();
+    config.pingInterval = 10;
+    config.pingTimeout = 5;
+    Session session(config);
+    size_t alice = session.connect("alice");
+    size_t bob = session.connect("bob");
+    session.send(alice, "JOIN #c\r\n");
+    session.send(bob, "JOIN #c\r\n");
+    session.output(alice);
+
+    session.elapse(10200);
+    expect(test, session.output(alice), "PING :ircserv\r\n");
+    expect(test, session.send(bob, "PONG :ircserv\r\n"), "PING :ircserv\r\n");
+
+    session.elapse(5200);
+    expectTrue(test, session.peer(alice).isClosed(), "the client that did not answer to be dropped");
+    expect(test, session.output(alice), "ERROR :Closing Link: loopback (Ping timeout: ");
+    expectTrue(test, !session.peer(bob).isClosed(), "the client that answered to stay connected");
+    expect(test, session.output(bob), ":alice QUIT :Ping timeout: ");
+}
+
+// A flood-limited client whose input buffer is full of waiting lines is not read, so a reset
+// of its connection has to close it by itself instead of waiting on those lines
+static void resetWhileReadBlocked()
+{
+    const char* test = "resetWhileReadBlocked";
+    ServerConfig config = Session::defaults();
+    config.flood.burst = 10;
+    config.flood.rate = 1;
+    Session session(config);
+    size_t flooder = session.connect("flooder");
+    std::string lines;
+    for (size_t n = 0; n < InputBuffer::CAPACITY / 8 + 100; ++n)
+        lines += "PING x\r\n";
+    session.send(flooder, lines);
+    expectTrue(test, !session.peer(flooder).isClosed(), "the throttled client to stay connected");
+
+    session.peer(flooder).reset();
+    session.run();
+    expectTrue(test, session.peer(flooder).isClosed(), "the reset connection to be closed in one iteration");
+}
+
+// Gated commands from an unregistered client get 451 before any parameter check; once
+// registered, a missing parameter gets 461
+static void registrationBeforeParameters()
+{
+    const char* test = "registrationBeforeParameters";
+    Session session;
+    size_t early = session.open();
+    session.send(early, "PASS pw\r\nNICK early\r\n");
+    const char* gated[] = { "JOIN", "KICK #a", "INVITE", "TOPIC", "MODE", "PRIVMSG", "NAMES #a", "STATS" };
+    for (size_t i = 0; i < sizeof(gated) / sizeof(gated[0]); ++i) {
+        std::string reply = session.send(early, std::string(gated[i]) + "\r\n");
+        expect(test, reply, ":ircserv 451 early :You have not registered");
+        expectNot(test, reply, " 461 ");
+    }
+    expect(test, session.send(early, "USER\r\n"), ":ircserv 461 early USER :Not enough parameters");
+
+    size_t alice = session.connect("alice");
+    std::string reply = session.send(alice, "JOIN\r\n");
+    expect(test, reply, ":ircserv 461 alice JOIN :Not enough parameters");
+    expectNot(test, reply, " 451 ");
+}
+
+int main()
+{
+    LogConfig log;
+    log.level = LOG_ERROR;
+    Log::start(log);
+    try {
+        nickCasemapping();
+        inviteEndsWithConnection();
+        inviteAdmits();
+        quitOncePerPeer();
+        namesFitLine();
+        namesUseChannelSpelling();
+        channelModes();
+        registrationBeforeParameters();
+        sendQEviction();
+        resetWhileReadBlocked();
+        registrationTimeout();
+        pingTimeout();
+    } catch (const std::exception& e) {
+        std::cout << "FAIL: " << e.what() << "\n";
+        ++g_failures;
+    }
+    Log::stop();
+    if (g_failures) {
+        std::cout << g_failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All protocol tests passed\n";
+    return 0;
+}